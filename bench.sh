@@ -0,0 +1,30 @@
+#!/bin/sh
+# Builds blotto and the benchmark tools into a scratch directory and runs
+# the scale ladder.  Arguments are passed to bench_blotto, for example
+#   ./bench.sh -n 6 -b 10
+# runs the full ladder, and
+#   ./bench.sh -n 4 -- --threads 4
+# passes --threads 4 to every blotto run.  With gmap as the first
+# argument the gmap microbenchmark is run instead, for example
+#   ./bench.sh gmap -n 100000 -k generated
+set -e
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-std=c99 -Wall -pedantic -O2"}
+if [ -z "$BENCH_DIR" ]; then
+    BENCH_DIR=$(mktemp -d)
+    trap 'rm -rf "$BENCH_DIR"' EXIT
+fi
+SRC=$(dirname "$0")
+
+$CC $CFLAGS -o "$BENCH_DIR/blotto" $(ls "$SRC"/*.c | grep -v -e gen_tournament.c -e bench_blotto.c -e gmap_bench.c) -lm -lpthread
+$CC $CFLAGS -o "$BENCH_DIR/gen_tournament" "$SRC/gen_tournament.c"
+$CC $CFLAGS -o "$BENCH_DIR/bench_blotto" "$SRC/bench_blotto.c"
+$CC $CFLAGS -o "$BENCH_DIR/gmap_bench" "$SRC/gmap_bench.c" "$SRC/gmap.c" "$SRC/cgmap.c" "$SRC/string_key.c" -lpthread
+
+if [ "$1" = "gmap" ]; then
+    shift
+    "$BENCH_DIR/gmap_bench" "$@"
+else
+    "$BENCH_DIR/bench_blotto" "$BENCH_DIR/blotto" "$BENCH_DIR/gen_tournament" "$BENCH_DIR" "$@"
+fi
@@ -0,0 +1,307 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/**
+ * End-to-end benchmark of blotto over a ladder of synthetic tournaments.
+ * For each rung it generates a tournament with gen_tournament, times
+ * blotto loading the field alone (a one-line matchup file) and then
+ * playing every matchup, and reports wall time, throughput and the peak
+ * resident set size of each phase.  The throughput of the play phase
+ * leaves out the time spent loading the field.  The matchups are then
+ * played again with --reorder, whose speedup over the play phase, both
+ * without loading, is reported in the last column.
+ *
+ * usage: bench_blotto blotto gen_tournament workdir [options] [-- extra blotto arguments]
+ *
+ * with options
+ *   -n rungs        number of rungs of the ladder to run (default 3, at most 6)
+ *   -b battlefields number of battlefields (default 10)
+ *   -d rate         duplicate-distribution rate passed to the generator (default 0.3)
+ *   -r rate         repeated-pair rate passed to the generator (default 0.2)
+ *   -s seed         generator seed (default 1)
+ */
+
+/**
+ * One rung of the scale ladder
+ */
+typedef struct _rung
+{
+    const char *players;
+    const char *matchups;
+} rung;
+
+static const rung ladder[] =
+{
+    {"1000", "10000"},
+    {"10000", "100000"},
+    {"100000", "1000000"},
+    {"1000000", "10000000"},
+    {"10000000", "100000000"},
+    {"10000000", "1000000000"}
+};
+
+#define LADDER_SIZE ((int) (sizeof(ladder) / sizeof(ladder[0])))
+
+/**
+ * Cost of running one process
+ *
+ * @param seconds the wall time
+ * @param cpu the user plus system time
+ * @param peak_kb the peak resident set size in kilobytes
+ * @param status the exit status
+ */
+typedef struct _run_cost
+{
+    double seconds;
+    double cpu;
+    long peak_kb;
+    int status;
+} run_cost;
+
+bool bench_run(char *const args[], const char *in, run_cost *cost);
+bool bench_first_id(const char *dist, char *id, size_t size);
+void bench_report(const char *phase, const rung *r, double items, double seconds, const run_cost *cost, double speedup);
+
+int main(int argc, char *argv[])
+{
+    int rungs = 3;
+    const char *battlefields = "10";
+    const char *dup_rate = "0.3";
+    const char *repeat_rate = "0.2";
+    const char *seed = "1";
+    const char *paths[3];
+    int num_paths = 0;
+    int extra = argc;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--") == 0)
+        {
+            extra = i + 1;
+            break;
+        }
+        else if (argv[i][0] == '-' && i + 1 < argc)
+        {
+            char flag = argv[i][1];
+            const char *value = argv[++i];
+            if (flag == 'n')
+            {
+                rungs = atoi(value);
+            }
+            else if (flag == 'b')
+            {
+                battlefields = value;
+            }
+            else if (flag == 'd')
+            {
+                dup_rate = value;
+            }
+            else if (flag == 'r')
+            {
+                repeat_rate = value;
+            }
+            else if (flag == 's')
+            {
+                seed = value;
+            }
+        }
+        else if (num_paths < 3)
+        {
+            paths[num_paths++] = argv[i];
+        }
+    }
+
+    if (num_paths != 3 || rungs < 1 || rungs > LADDER_SIZE)
+    {
+        fprintf(stderr, "usage: bench_blotto blotto gen_tournament workdir [-n rungs] [-b battlefields]"
+                " [-d rate] [-r rate] [-s seed] [-- extra blotto arguments]\n");
+        return 1;
+    }
+
+    //every battlefield gets weight 1 after the extra arguments
+    int num_bf = atoi(battlefields);
+    int num_extra = argc - extra;
+    char **args = malloc(sizeof(char*) * (num_extra + num_bf + 6));
+    char prefix[4000], dist[4096], match[4096], one[4096];
+    snprintf(prefix, sizeof(prefix), "%s/bench", paths[2]);
+    snprintf(dist, sizeof(dist), "%s.dist", prefix);
+    snprintf(match, sizeof(match), "%s.match", prefix);
+    snprintf(one, sizeof(one), "%s.one", prefix);
+
+    printf("%-9s %10s %12s %10s %10s %14s %10s %10s\n", "phase", "players", "matchups", "wall_s", "cpu_s", "items_per_s", "peak_mb", "speedup");
+
+    for (int r = 0; r < rungs; r++)
+    {
+        const rung *rg = &ladder[r];
+        run_cost cost;
+        double load_seconds = 0.0;
+        double play_seconds = 0.0;
+
+        char *gen_args[] = {(char*) paths[1], "-p", (char*) rg->players, "-b", (char*) battlefields,
+                            "-m", (char*) rg->matchups, "-d", (char*) dup_rate, "-r", (char*) repeat_rate,
+                            "-s", (char*) seed, prefix, NULL};
+        if (!bench_run(gen_args, NULL, &cost) || cost.status != 0)
+        {
+            fprintf(stderr, "bench_blotto: generator failed\n");
+            return 1;
+        }
+        bench_report("generate", rg, atof(rg->players) + atof(rg->matchups), cost.seconds, &cost, 0.0);
+
+        //a single self-matchup makes blotto do little beyond loading the field
+        char id[64];
+        FILE *f = fopen(one, "w");
+        if (f == NULL || !bench_first_id(dist, id, sizeof(id)))
+        {
+            fprintf(stderr, "bench_blotto: could not write %s\n", one);
+            return 1;
+        }
+        fprintf(f, "%s %s\n", id, id);
+        fclose(f);
+
+        for (int phase = 0; phase < 3; phase++)
+        {
+            int n = 0;
+            args[n++] = (char*) paths[0];
+            for (int i = extra; i < argc; i++)
+            {
+                args[n++] = argv[i];
+            }
+            if (phase == 2)
+            {
+                args[n++] = "--reorder";
+            }
+            args[n++] = (phase == 0 ? one : match);
+            args[n++] = "win";
+            for (int i = 0; i < num_bf; i++)
+            {
+                args[n++] = "1";
+            }
+            args[n] = NULL;
+
+            if (!bench_run(args, dist, &cost) || cost.status != 0)
+            {
+                fprintf(stderr, "bench_blotto: blotto failed\n");
+                return 1;
+            }
+
+            if (phase == 0)
+            {
+                load_seconds = cost.seconds;
+                bench_report("load", rg, atof(rg->players), cost.seconds, &cost, 0.0);
+            }
+            else if (phase == 1)
+            {
+                play_seconds = cost.seconds - load_seconds;
+                bench_report("play", rg, atof(rg->matchups), play_seconds, &cost, 0.0);
+            }
+            else
+            {
+                double seconds = cost.seconds - load_seconds;
+                bench_report("reorder", rg, atof(rg->matchups), seconds, &cost, (seconds > 0 ? play_seconds / seconds : 0.0));
+            }
+        }
+
+        fflush(stdout);
+    }
+
+    remove(dist);
+    remove(match);
+    remove(one);
+    free(args);
+
+    return 0;
+}
+
+//function for running a program with its standard output discarded
+bool bench_run(char *const args[], const char *in, run_cost *cost)
+{
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        if (in != NULL)
+        {
+            int fd = open(in, O_RDONLY);
+            if (fd < 0 || dup2(fd, STDIN_FILENO) < 0)
+            {
+                _exit(127);
+            }
+        }
+
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0)
+        {
+            dup2(null, STDOUT_FILENO);
+        }
+
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    struct rusage usage;
+    int status;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        return false;
+    }
+    gettimeofday(&end, NULL);
+
+    cost->seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    cost->cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    cost->peak_kb = usage.ru_maxrss;
+    cost->status = (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+
+    return true;
+}
+
+//function for reading the id on the first line of a distribution file
+bool bench_first_id(const char *dist, char *id, size_t size)
+{
+    FILE *f = fopen(dist, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    size_t len = 0;
+    int ch;
+    while ((ch = fgetc(f)) != EOF && ch != ',' && len + 1 < size)
+    {
+        id[len++] = ch;
+    }
+    id[len] = '\0';
+    fclose(f);
+
+    return len > 0;
+}
+
+//function for printing one phase, with throughput as items per second of the given time and the speedup if there is one
+void bench_report(const char *phase, const rung *r, double items, double seconds, const run_cost *cost, double speedup)
+{
+    printf("%-9s %10s %12s %10.3f %10.3f %14.0f %10.1f", phase, r->players, r->matchups,
+           cost->seconds, cost->cpu, (seconds > 0 ? items / seconds : 0.0), cost->peak_kb / 1024.0);
+    if (speedup > 0)
+    {
+        printf(" %9.2fx\n", speedup);
+    }
+    else
+    {
+        printf(" %10s\n", "-");
+    }
+}
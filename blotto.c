@@ -1,50 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
-
-#include "gmap.h"
-#include "entry.h"
-#include "string_key.h"
-
-/** 
- * Creates a struct that keeps track of each players results
- * 
- * @param id a string of the player's id
- * @param wins an integer that keeps track of the wins
- * @param score an integer that keeps track of the score per match
- * @param overall_score an integer that keeps track of the overall score
- * @param games an integer that keeps track of the games played
+#include <time.h>
+#include <unistd.h>
+
+#include "libblotto.h"
+#include "stats.h"
+#include "server.h"
+
+//matchups sorted at a time by --reorder
+#define REORDER_BLOCK (1 << 20)
+
+/**
+ * Command line options, which may appear anywhere among the arguments
+ *
+ * @param query true to score the distributions in the file named by argv[1]
+ * against the field instead of playing the matchups in it
+ * @param threads the number of threads to use where work is split
+ * @param updates the name of a file of new distributions for existing players
+ * to apply after the matchups are played, or NULL
+ * @param stats true to write per-phase timings and counters to stderr as JSON
+ * @param checkpoint the name of a file to save progress to while playing, or NULL
+ * @param checkpoint_every the number of matchups between saves
+ * @param resume true to continue from the progress saved in the checkpoint file
+ * @param weightings the name of a file of battlefield weights, one weighting
+ * per line, to play the matchups under all at once instead of under the
+ * weights on the command line, or NULL
+ * @param reorder true to play the matchups a block at a time, sorted so that
+ * matchups between nearby players are played together
+ * @param serve the path of a Unix domain socket to serve requests on, with
+ * the matchups in the file named by argv[1] as the standing matchups, or NULL
+ * @param schedule true to play matchups made up by plan instead of reading
+ * them from a file, in which case argv[1] is the schedule as given
+ * @param plan the schedule to play, "swiss:ROUNDS", "random:OPPONENTS" or
+ * "groups:SIZE" on the command line, with the seed given by --seed
+ * @param matrix the name of a file to write the outcome of every pairing of
+ * the field to instead of playing, in which case every argument is a
+ * weight, or NULL
+ * @param matrix_scores the width in bits of the scores written with the
+ * matrix, 0 for none
+ * @param estimate true to estimate each player's results by sampling
+ * opponents instead of playing matchups, in which case argv[1] is the
+ * precision as given
+ * @param sampling how to sample, with the precision given by --estimate,
+ * the opponents by --samples and the seed by --seed
+ * @param optimize true to search for the distributions that do best against
+ * the field instead of playing matchups, in which case argv[1] is the
+ * number of units as given
+ * @param search how to search, with the units given by --optimize, the time
+ * by --seconds, the number of distributions by --keep and the seed by --seed
  */
-typedef struct _result
+typedef struct _options
 {
-    char *id;
-    double wins;
-    double score;
-    double overall_score;
-    double games;
-} result;
-
-//max_id of characters
-#define MAX_ID 32
+    bool query;
+    int threads;
+    char *updates;
+    bool stats;
+    char *checkpoint;
+    size_t checkpoint_every;
+    bool resume;
+    char *weightings;
+    bool reorder;
+    char *serve;
+    bool schedule;
+    blotto_schedule plan;
+    char *matrix;
+    int matrix_scores;
+    bool estimate;
+    blotto_sampling sampling;
+    bool optimize;
+    blotto_search search;
+} options;
+
+//removes the options from argv and returns the number of arguments left, or -1
+int parse_options(int argc, char *argv[], options *opts);
 
 //function for handling commmand line argument errors
-int handle_errors(FILE* location_file, int argc, char *argv[]);
+int handle_errors(FILE* location_file, int argc, char *argv[], bool weightings, bool generated);
+
+//prints the rankings argv[2] asks for, each headed when there is more than one
+void print_rankings(blotto_results *results, char *argv[], bool query, bool estimated, const char *heading);
+
+//prints the results sorted by wins or by score, with the average score too for candidates and the margin for estimates
+void print_results(blotto_results *results, bool by_wins, bool query, bool estimated);
+
+//reads the weightings in a file, one per line, and the number of battlefields each has
+double *read_weightings(FILE *in, int *battlefields, size_t *k);
 
-//run a blotto game based on the wins
-void play_blotto(gmap *all_players, FILE* matchup_file, int battlefields, char *argv[]);
+//parses the weight of each battlefield from the command line
+double *parse_weights(char *argv[], int battlefields);
 
-//functions for qsort comparison
-int cmpfunc_win(const void *key1, const void *key2);
-int cmpfunc_score(const void *key1, const void *key2);
+//reads the rest of a file into memory
+char *read_file(FILE *in, size_t *len);
 
-//functions for freeing gmaps
-void free_fnc(gmap *all_players);
-void free_fnc2(gmap *point_map);
+//parses a schedule given as kind:size, returning false if it is not one
+bool parse_schedule(const char *arg, blotto_schedule *plan);
+
+//writes the matrix of the field read from standard input to the file named by --matrix
+int write_matrix(int argc, char *argv[], const options *opts);
 
 int main(int argc, char *argv[])
 {
+    options opts;
+    argc = parse_options(argc, argv, &opts);
+    if (argc == -1)
+    {
+        exit(1);
+    }
+
+    stats_init(opts.stats);
+
+    //there are no matchups to read when writing the matrix of every pairing
+    if (opts.matrix != NULL)
+    {
+        return write_matrix(argc, argv, &opts);
+    }
+
     //checks if file is present
     if (argv[1] == NULL)
     {
@@ -52,408 +128,850 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    FILE *matchup_file;
-    matchup_file = fopen(argv[1], "r");
+    //a schedule, sampling or search makes its matchups up, so there is no file of them
+    bool generated = (opts.schedule || opts.estimate || opts.optimize);
+    FILE *matchup_file = NULL;
+    if (!generated)
+    {
+        matchup_file = fopen(argv[1], "r");
+    }
 
     //handles command line errors
-    if (handle_errors(matchup_file, argc, argv) == 1) 
+    if (handle_errors(matchup_file, argc, argv, opts.weightings != NULL, generated) == 1) 
     {
         exit(1);
     }
 
-    //for-loop that checks the command line distribution value are greater than 0
-    for (size_t i = 3; i < argc; i++)
+    //the battlefields are counted from the weightings when they come from a file
+    double *weightings = NULL;
+    size_t k = 1;
+    int battlefields = argc - 3;
+    if (opts.weightings != NULL)
     {
-        if (atoi(argv[i]) <= 0)
+        FILE *weightings_file = fopen(opts.weightings, "r");
+        if (weightings_file != NULL)
+        {
+            weightings = read_weightings(weightings_file, &battlefields, &k);
+            fclose(weightings_file);
+        }
+        if (weightings == NULL)
         {
             fclose(matchup_file);
-            fprintf(stderr, "Blotto: distribution needs to be postive integers\n");
+            fprintf(stderr, "Blotto: invalid weights file %s\n", opts.weightings);
             exit(1);
         }
     }
 
-    //variable to keep track of the number of games
-    int battlefields = argc - 3;
-
-    gmap *all_players = gmap_create(duplicate, compare_keys, hash29, free);
-
-    //reads in the values from standard input
-    entry player = entry_read(stdin, MAX_ID, battlefields);
-    while (player.id != NULL && strcmp(player.id, "") != 0)
+    FILE *update_file = NULL;
+    if (opts.updates != NULL)
     {
-
-        if (gmap_contains_key(all_players, player.id))
+        update_file = fopen(opts.updates, "r");
+        if (update_file == NULL)
         {
-            free(player.id);
-            free(player.distribution);
-            //entry_destroy(&player);
-
-            free_fnc(all_players);
             fclose(matchup_file);
-
-            fprintf(stderr, "Blotto: Duplicate Player\n");
+            fprintf(stderr, "Blotto: could not open %s\n", opts.updates);
             exit(1);
         }
-
-        gmap_put(all_players, player.id, player.distribution);
-        free(player.id);
-        player = entry_read(stdin, MAX_ID, battlefields);    
     }
 
-    if (player.id != NULL)
+    //for-loop that checks the command line distribution value are greater than 0
+    for (size_t i = 3; i < argc; i++)
     {
-        free(player.id);
+        if (atoi(argv[i]) <= 0)
+        {
+            if (matchup_file != NULL)
+            {
+                fclose(matchup_file);
+            }
+            fprintf(stderr, "Blotto: distribution needs to be postive integers\n");
+            exit(1);
+        }
     }
 
-    //check if plyer.id is NULL
-    if (player.id == NULL)
+    //reads in the values from standard input, parsed on several threads
+    blotto_error error;
+    blotto_field *field = blotto_field_load(stdin, battlefields, opts.threads, &error);
+    if (field == NULL)
     {
-        free_fnc(all_players);
-        fclose(matchup_file);
+        if (matchup_file != NULL)
+        {
+            fclose(matchup_file);
+        }
+        if (update_file != NULL)
+        {
+            fclose(update_file);
+        }
 
-        fprintf(stderr, "Blotto: Invalid Distribution\n");
+        fprintf(stderr, "Blotto: %s\n", blotto_strerror(error));
         exit(1);
     }
 
-    if (gmap_size(all_players) == 0)
+    //several weightings are played together, with a ranking for each
+    if (weightings != NULL)
     {
-        gmap_destroy(all_players);
+        blotto_results **all = malloc(sizeof(blotto_results*) * k);
+        error = (all == NULL ? BLOTTO_NO_MEMORY : blotto_play_weightings(field, weightings, k, matchup_file, all));
+        blotto_field_destroy(field);
         fclose(matchup_file);
+        if (error != BLOTTO_OK)
+        {
+            free(all);
+            free(weightings);
+            fprintf(stderr, "Blotto: %s\n", blotto_strerror(error));
+            exit(1);
+        }
 
-        fprintf(stderr, "Blotto: Empty Distribution File\n");
-        exit(1);
+        for (size_t j = 0; j < k; j++)
+        {
+            //each ranking is headed by its weights
+            char heading[64 + 32 * BLOTTO_MAX_ID];
+            int used = snprintf(heading, sizeof(heading), "weights");
+            for (int i = 0; i < battlefields && used < (int) sizeof(heading); i++)
+            {
+                used += snprintf(heading + used, sizeof(heading) - used, " %g", weightings[j * battlefields + i]);
+            }
+
+            print_rankings(all[j], argv, false, false, heading);
+            blotto_results_destroy(all[j]);
+        }
+        free(all);
+        free(weightings);
+
+        stats_switch(PHASE_NONE);
+        stats_dump(stderr);
+        return 0;
     }
 
-    //function to run blotto game
-    play_blotto(all_players, matchup_file, battlefields, argv);
+    //weight of each battlefield, parsed once from the command line
+    double *weights = parse_weights(argv, battlefields);
 
-    free_fnc(all_players);
+    //keep the field loaded and answer requests until told to stop
+    if (opts.serve != NULL)
+    {
+        size_t len;
+        char *matchups = read_file(matchup_file, &len);
+        fclose(matchup_file);
+        if (update_file != NULL)
+        {
+            fclose(update_file);
+        }
 
-    fclose(matchup_file);
-}
+        //requests run concurrently, so the stats only cover loading the field
+        stats_switch(PHASE_NONE);
+        stats_dump(stderr);
+        stats_enabled = false;
 
-int handle_errors(FILE* matchup_file, int argc, char *argv[])
-{
-    //checks if file opens
-    if (!matchup_file || matchup_file == NULL)
+        bool ok = (matchups != NULL && serve(opts.serve, field, weights, matchups, len, opts.threads));
+        if (matchups == NULL)
+        {
+            blotto_field_destroy(field);
+        }
+        free(matchups);
+        free(weights);
+
+        if (!ok)
+        {
+            fprintf(stderr, "Blotto: could not serve on %s\n", opts.serve);
+            exit(1);
+        }
+        return 0;
+    }
+
+    //play the matchups, or score candidates against the field
+    blotto_results *results;
+    struct timespec start, end;
+    if (opts.query)
     {
-        fprintf(stderr, "Blotto: could not open %s\n", argv[1]);
-        return 1;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        results = blotto_query(field, weights, matchup_file, opts.threads, &error);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+    }
+    else if (update_file != NULL)
+    {
+        results = blotto_play_updates(field, weights, matchup_file, update_file, &error);
+    }
+    else if (opts.reorder)
+    {
+        results = blotto_play_reordered(field, weights, matchup_file, REORDER_BLOCK, &error);
+    }
+    else if (opts.schedule)
+    {
+        results = blotto_play_schedule(field, weights, &opts.plan, &error);
+    }
+    else if (opts.estimate)
+    {
+        //the boundaries of the ranking asked for are the ones sampled most, those by wins for both
+        opts.sampling.order = (strcmp(argv[2], "score") == 0 ? BLOTTO_BY_SCORE : BLOTTO_BY_WINS);
+        results = blotto_estimate(field, weights, &opts.sampling, opts.threads, &error);
+    }
+    else if (opts.optimize)
+    {
+        //both searches for the best win rate, as with estimates
+        opts.search.order = (strcmp(argv[2], "score") == 0 ? BLOTTO_BY_SCORE : BLOTTO_BY_WINS);
+        results = blotto_optimize(field, weights, &opts.search, opts.threads, &error);
+    }
+    else
+    {
+        blotto_checkpoint cp = {opts.checkpoint, opts.checkpoint_every, opts.resume};
+        results = blotto_play_checkpointed(field, weights, matchup_file, (opts.checkpoint != NULL ? &cp : NULL), &error);
     }
 
-    //check if second argument is win or score
-    else if (argv[2] == NULL || (strcmp(argv[2], "win") != 0 && strcmp(argv[2], "score") != 0))
+    free(weights);
+    blotto_field_destroy(field);
+    if (matchup_file != NULL)
     {
         fclose(matchup_file);
-        fprintf(stderr, "Blotto: missing 'win' or 'score'\n");
-        return 1;
+    }
+    if (update_file != NULL)
+    {
+        fclose(update_file);
     }
 
-    //check is distribution present
-    else if (argv[3] == NULL)
+    if (results == NULL)
     {
-        fclose(matchup_file);
-        fprintf(stderr, "Blotto: missing distribution\n");
-        return 1;
+        fprintf(stderr, "Blotto: %s\n", blotto_strerror(error));
+        exit(1);
     }
 
-    return 0;
-}
+    //distributions found by a search are reported as candidates are
+    print_rankings(results, argv, opts.query || opts.optimize, opts.estimate, NULL);
 
-void play_blotto(gmap *all_players, FILE* matchup_file, int battlefields, char *argv[])
-{
-    //gmap for ids and result structs
-    gmap *point_map = gmap_create(duplicate, compare_keys, hash29, free);
+    if (opts.query)
+    {
+        size_t n = blotto_results_size(results);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        double opponents = blotto_results_get(results, 0)->games;
+        fprintf(stderr, "Blotto: scored %zu candidates x %.0f opponents in %.3f s (%.3g matchups/s)\n",
+                n, opponents, seconds, (seconds > 0 ? n * opponents / seconds : 0.0));
+    }
 
-    //strings to store ids fread form matchup file
-    char id1[MAX_ID];
-    char id2[MAX_ID];
+    blotto_results_destroy(results);
 
-    //num for fscanf
-    int num;
+    stats_switch(PHASE_NONE);
+    stats_dump(stderr);
+}
 
-    //arrays of integeres for distrbution of two competitors
-    int *arr1;
-    int *arr2;
+int parse_options(int argc, char *argv[], options *opts)
+{
+    opts->query = false;
+    opts->updates = NULL;
+    opts->stats = false;
+    opts->serve = NULL;
+    opts->checkpoint = NULL;
+    opts->checkpoint_every = 1000000;
+    opts->resume = false;
+    opts->weightings = NULL;
+    opts->reorder = false;
+    opts->schedule = false;
+    opts->plan.kind = BLOTTO_SCHEDULE_SWISS;
+    opts->plan.size = 0;
+    opts->plan.seed = 1;
+    opts->matrix = NULL;
+    opts->matrix_scores = 0;
+    opts->estimate = false;
+    opts->sampling.initial = 256;
+    opts->sampling.limit = 65536;
+    opts->sampling.precision = 0.0;
+    opts->sampling.order = BLOTTO_BY_WINS;
+    opts->optimize = false;
+    opts->search.units = 0;
+    opts->search.seconds = 10.0;
+    opts->search.keep = 10;
+    opts->search.order = BLOTTO_BY_WINS;
+    opts->threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (opts->threads < 1)
+    {
+        opts->threads = 1;
+    }
 
-    //game structs
-    result *game1;
-    result *game2;
+    //copy every argument that is not an option down, keeping the trailing NULL
+    int kept = 1;
+    char *source_arg = NULL;
+    bool samples = false;
+    bool search_options = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--query") == 0)
+        {
+            opts->query = true;
+        }
 
-    //variable for fgetc()
-    int ch;
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+            opts->stats = true;
+        }
 
-    //check whether there is a blank space or empty line in the beginning of the file
-    if ((ch = fgetc(matchup_file)) == 32 || ch == 10)
-    {
-        free_fnc(all_players);
-        gmap_destroy(point_map);
-        fclose(matchup_file);
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Blotto: --threads needs a positive integer\n");
+                return -1;
+            }
+            opts->threads = atoi(argv[++i]);
+        }
 
-        fprintf(stderr, "Blotto: Invalid Matchup File\n");
-        exit(1);
-    }
+        else if (strcmp(argv[i], "--updates") == 0)
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Blotto: --updates needs a filename\n");
+                return -1;
+            }
+            opts->updates = argv[++i];
+        }
 
-    else
-    {
-        ungetc(ch, matchup_file);
-    }
+        else if (strcmp(argv[i], "--checkpoint") == 0)
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Blotto: --checkpoint needs a filename\n");
+                return -1;
+            }
+            opts->checkpoint = argv[++i];
+        }
 
-    //cloop through matchup file
-    while ((num = fscanf(matchup_file, "%s %s", id1, id2)) == 2)
-    {
-        //checks if matchup file starts with an empty line or a space
-        if ((ch = fgetc(matchup_file)) != 10 && ch != EOF)
+        else if (strcmp(argv[i], "--checkpoint-every") == 0)
         {
-            free_fnc(all_players);
-            gmap_destroy(point_map);
-            fclose(matchup_file);
+            if (i + 1 == argc || atol(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Blotto: --checkpoint-every needs a positive integer\n");
+                return -1;
+            }
+            opts->checkpoint_every = atol(argv[++i]);
+        }
 
-            fprintf(stderr, "Blotto: Wrong Matchup File\n");
-            exit(1);    
-        } 
+        else if (strcmp(argv[i], "--resume") == 0)
+        {
+            opts->resume = true;
+        }
 
-        //checks whether ids have a distribtuion
-        if (gmap_contains_key(all_players, id1) && gmap_contains_key(all_players, id2))
+        else if (strcmp(argv[i], "--weights") == 0)
         {
-            //if id doesn't have an entry yet, create one
-            if (gmap_contains_key(point_map, id1) == false)
+            if (i + 1 == argc)
             {
-                //struct for initialization
-                result *stats = malloc(sizeof(result));
-                stats->games = 0.0;
-                stats->score = 0.0;
-                stats->overall_score = 0.0;
-                stats->wins = 0.0;
-                stats->id = malloc(sizeof(char) * MAX_ID);
-                strcpy(stats->id, id1);
-                gmap_put(point_map, id1, stats);  
+                fprintf(stderr, "Blotto: --weights needs a filename\n");
+                return -1;
             }
+            opts->weightings = argv[++i];
+        }
+
+        else if (strcmp(argv[i], "--reorder") == 0)
+        {
+            opts->reorder = true;
+        }
 
-            if (gmap_contains_key(point_map, id2) == false)
+        else if (strcmp(argv[i], "--schedule") == 0)
+        {
+            if (i + 1 == argc || !parse_schedule(argv[i + 1], &opts->plan))
             {
-                //struct for initialization
-                result *stats = malloc(sizeof(result));
-                stats->games = 0.0;
-                stats->score = 0.0;
-                stats->overall_score = 0.0;
-                stats->wins = 0.0;
-                stats->id = malloc(sizeof(char) * MAX_ID);
-                strcpy(stats->id, id2);
-                gmap_put(point_map, id2, stats);  
+                fprintf(stderr, "Blotto: --schedule needs swiss:ROUNDS, random:OPPONENTS or groups:SIZE\n");
+                return -1;
             }
+            opts->schedule = true;
+            source_arg = argv[++i];
+        }
 
-            //assign distribution stored in all_players for the respective id to array
-            arr1 = gmap_get(all_players, id1);
-            arr2 = gmap_get(all_players, id2);
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            char *end = NULL;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                opts->plan.seed = strtoull(argv[i + 1], &end, 10);
+            }
+            if (end == NULL || end == argv[i + 1] || *end != '\0')
+            {
+                fprintf(stderr, "Blotto: --seed needs a non-negative integer\n");
+                return -1;
+            }
+            i++;
+        }
 
-            for (int i = 0; i < battlefields; i++)
+        else if (strcmp(argv[i], "--estimate") == 0)
+        {
+            char *end = NULL;
+            if (i + 1 < argc)
             {
-                if (arr1[i] > arr2[i])
-                {
-                    game1 = gmap_get(point_map, id1);
-                    game1->score += atof(argv[i + 3]);
-                }
+                opts->sampling.precision = strtod(argv[i + 1], &end);
+            }
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || !(opts->sampling.precision > 0))
+            {
+                fprintf(stderr, "Blotto: --estimate needs a positive precision\n");
+                return -1;
+            }
+            opts->estimate = true;
+            source_arg = argv[++i];
+        }
 
-                if (arr1[i] == arr2[i])
-                {
-                    game1 = gmap_get(point_map, id1);
-                    game2 = gmap_get(point_map, id2);
-                    game1->score += (atof(argv[i + 3])/2);
-                    game2->score += (atof(argv[i + 3])/2);
-                }
+        else if (strcmp(argv[i], "--samples") == 0)
+        {
+            char *end = NULL;
+            long initial = 0;
+            long limit = 0;
+            if (i + 1 < argc)
+            {
+                initial = strtol(argv[i + 1], &end, 10);
+            }
+            if (end != NULL && *end == ':')
+            {
+                limit = strtol(end + 1, &end, 10);
+            }
+            if (end == NULL || *end != '\0' || initial <= 0 || limit < initial)
+            {
+                fprintf(stderr, "Blotto: --samples needs MIN:MAX, positive with MIN no more than MAX\n");
+                return -1;
+            }
+            opts->sampling.initial = initial;
+            opts->sampling.limit = limit;
+            samples = true;
+            i++;
+        }
 
-                if (arr1[i] < arr2[i])
-                {
-                    game2 = gmap_get(point_map, id2);
-                    game2->score += atof(argv[i + 3]);
-                }
+        else if (strcmp(argv[i], "--optimize") == 0)
+        {
+            char *end = NULL;
+            long units = 0;
+            if (i + 1 < argc)
+            {
+                units = strtol(argv[i + 1], &end, 10);
+            }
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || units <= 0 || units > INT_MAX)
+            {
+                fprintf(stderr, "Blotto: --optimize needs a positive number of units\n");
+                return -1;
             }
+            opts->search.units = units;
+            opts->optimize = true;
+            source_arg = argv[++i];
+        }
 
-            game1 = gmap_get(point_map, id1);
-            game2 = gmap_get(point_map, id2);
+        else if (strcmp(argv[i], "--seconds") == 0)
+        {
+            char *end = NULL;
+            if (i + 1 < argc)
+            {
+                opts->search.seconds = strtod(argv[i + 1], &end);
+            }
+            if (end == NULL || end == argv[i + 1] || *end != '\0' || !(opts->search.seconds > 0))
+            {
+                fprintf(stderr, "Blotto: --seconds needs a positive number\n");
+                return -1;
+            }
+            search_options = true;
+            i++;
+        }
 
-            //set the scores to the overall score
-            game1->overall_score += game1->score;
-            game2->overall_score += game2->score;
+        else if (strcmp(argv[i], "--keep") == 0)
+        {
+            if (i + 1 == argc || atol(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Blotto: --keep needs a positive integer\n");
+                return -1;
+            }
+            opts->search.keep = atol(argv[++i]);
+            search_options = true;
+        }
 
-            //updates result structs for both ids
-            if (game1->score > game2->score)
+        else if (strcmp(argv[i], "--matrix") == 0)
+        {
+            if (i + 1 == argc)
             {
-                game1->wins++;
-                game1->games++;
-                game2->games++;
-                game1->score = 0;
-                game2->score = 0;
+                fprintf(stderr, "Blotto: --matrix needs a filename\n");
+                return -1;
             }
+            opts->matrix = argv[++i];
+        }
 
-            else if (game1->score == game2->score)
+        else if (strcmp(argv[i], "--matrix-scores") == 0)
+        {
+            if (i + 1 == argc || (atoi(argv[i + 1]) != 8 && atoi(argv[i + 1]) != 16))
             {
-                game1->wins += 0.5;
-                game2->wins += 0.5;
-                game1->games++;
-                game2->games++;
-                game1->score = 0;
-                game2->score = 0;
+                fprintf(stderr, "Blotto: --matrix-scores needs 8 or 16\n");
+                return -1;
             }
+            opts->matrix_scores = atoi(argv[++i]);
+        }
 
-            else
+        else if (strcmp(argv[i], "--serve") == 0)
+        {
+            if (i + 1 == argc)
             {
-                game2->wins++;
-                game1->games++;
-                game2->games++;
-                game1->score = 0;
-                game2->score = 0;
+                fprintf(stderr, "Blotto: --serve needs a socket path\n");
+                return -1;
             }
+            opts->serve = argv[++i];
         }
 
-        else
+        else if (strncmp(argv[i], "--", 2) == 0)
         {
-            free_fnc(all_players);
-            free_fnc2(point_map);
-            fclose(matchup_file);
+            fprintf(stderr, "Blotto: unknown option %s\n", argv[i]);
+            return -1;
+        }
 
-            fprintf(stderr, "Blotto: Invalid Player\n");
-            exit(1);
+        else
+        {
+            argv[kept++] = argv[i];
         }
     }
+    argv[kept] = NULL;
 
-    //if num doesn't return -1 (EOF) something is wrong with the format of the file
-    if (num != -1)
+    //the schedule, precision or units take the place of the matchup file, which the two options they came from leave room for
+    if (source_arg != NULL)
     {
-        free_fnc(all_players);
-        free_fnc2(point_map);
-        fclose(matchup_file);
+        memmove(argv + 2, argv + 1, sizeof(char*) * kept);
+        argv[1] = source_arg;
+        kept++;
+    }
+    opts->sampling.seed = opts->plan.seed;
+    opts->search.seed = opts->plan.seed;
 
-        fprintf(stderr, "Blotto: Issue with Matchup File\n");
-        exit(1);
+    if (opts->resume && opts->checkpoint == NULL)
+    {
+        fprintf(stderr, "Blotto: --resume needs --checkpoint\n");
+        return -1;
     }
 
-    //if matchup file is empty
-    if (gmap_size(point_map) == 0)
+    //progress is only saved while playing a matchup file from start to end
+    if (opts->checkpoint != NULL && (opts->query || opts->updates != NULL || opts->serve != NULL))
     {
-        free_fnc(all_players);
-        gmap_destroy(point_map);
-        fclose(matchup_file);
+        fprintf(stderr, "Blotto: --checkpoint cannot be used with --query, --updates or --serve\n");
+        return -1;
+    }
 
-        fprintf(stderr, "Blotto: Empty Matchup File\n");
-        exit(1);
+    //a server takes queries and updates as requests, not from the command line
+    if (opts->serve != NULL && (opts->query || opts->updates != NULL))
+    {
+        fprintf(stderr, "Blotto: --serve cannot be used with --query or --updates\n");
+        return -1;
     }
 
-    //create array of all result structs in point_map
-    result *stats_arr = malloc(sizeof(result) * gmap_size(point_map));
-    const char **key_arr = (const char**) gmap_keys(point_map);
+    //weightings from a file are only played, and their progress is not saved
+    if (opts->weightings != NULL && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->serve != NULL))
+    {
+        fprintf(stderr, "Blotto: --weights cannot be used with --query, --updates, --checkpoint or --serve\n");
+        return -1;
+    }
 
-    for (size_t i = 0; i < gmap_size(point_map); i++)
+    //reordering only applies to playing a single weighting from start to end
+    if (opts->reorder && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->weightings != NULL || opts->serve != NULL))
     {
-        stats_arr[i] = *(result*) gmap_get(point_map, key_arr[i]);
-        //printf("%s %lf", stats_arr[i]->id, stats_arr[i]->wins);
+        fprintf(stderr, "Blotto: --reorder cannot be used with --query, --updates, --checkpoint, --weights or --serve\n");
+        return -1;
     }
 
-    //in case of win
-    if (strcmp(argv[2], "win") == 0)
+    //a schedule is only played, under a single weighting
+    if (opts->schedule && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->weightings != NULL || opts->reorder || opts->serve != NULL))
     {
-        qsort(stats_arr, gmap_size(point_map), sizeof(result), cmpfunc_win);
+        fprintf(stderr, "Blotto: --schedule cannot be used with --query, --updates, --checkpoint, --weights, --reorder or --serve\n");
+        return -1;
+    }
 
-        for (int i = 0; i < gmap_size(point_map); i++)
-        {
-            printf("%7.3f %s\n", (stats_arr[i].wins/stats_arr[i].games), stats_arr[i].id); 
+    if (opts->matrix_scores != 0 && opts->matrix == NULL)
+    {
+        fprintf(stderr, "Blotto: --matrix-scores needs --matrix\n");
+        return -1;
+    }
 
-        }
-    } 
+    //the matrix is written on its own, from the field alone
+    if (opts->matrix != NULL && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->weightings != NULL || opts->reorder || opts->schedule || opts->estimate || opts->optimize || opts->serve != NULL))
+    {
+        fprintf(stderr, "Blotto: --matrix cannot be used with --query, --updates, --checkpoint, --weights, --reorder, --schedule, --estimate, --optimize or --serve\n");
+        return -1;
+    }
 
-    //in case of score
-    else if (strcmp(argv[2], "score") == 0)
+    if (samples && !opts->estimate)
     {
-        qsort(stats_arr, gmap_size(point_map), sizeof(result), cmpfunc_score);
+        fprintf(stderr, "Blotto: --samples needs --estimate\n");
+        return -1;
+    }
 
-        for (int i = 0; i < gmap_size(point_map); i++)
-        { 
-            printf("%7.3f %s\n", (stats_arr[i].overall_score/stats_arr[i].games), stats_arr[i].id); 
-        }
+    //estimates replace playing matchups altogether
+    if (opts->estimate && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->weightings != NULL || opts->reorder || opts->schedule || opts->serve != NULL))
+    {
+        fprintf(stderr, "Blotto: --estimate cannot be used with --query, --updates, --checkpoint, --weights, --reorder, --schedule or --serve\n");
+        return -1;
     }
 
-    free(stats_arr);
+    if (search_options && !opts->optimize)
+    {
+        fprintf(stderr, "Blotto: --seconds and --keep need --optimize\n");
+        return -1;
+    }
 
-    for (size_t i = 0; i < gmap_size(point_map); i++)
+    //a search only needs the field, which it does not play
+    if (opts->optimize && (opts->query || opts->updates != NULL || opts->checkpoint != NULL || opts->weightings != NULL || opts->reorder || opts->schedule || opts->estimate || opts->serve != NULL))
     {
-        free(((result *) gmap_get(point_map, key_arr[i]))->id);
-        free(gmap_get(point_map, key_arr[i]));
+        fprintf(stderr, "Blotto: --optimize cannot be used with --query, --updates, --checkpoint, --weights, --reorder, --schedule, --estimate or --serve\n");
+        return -1;
     }
 
-    free(key_arr);
-    gmap_destroy(point_map);
+    return kept;
 }
 
-int cmpfunc_win(const void *key1, const void *key2)
+int handle_errors(FILE* matchup_file, int argc, char *argv[], bool weightings, bool generated)
 {
-    //declares const void as result*
-    result *r1 = (result*)key1;
-    result *r2 = (result*)key2;
+    //checks if file opens, unless there is no file because the opponents are made up
+    if (matchup_file == NULL && !generated)
+    {
+        fprintf(stderr, "Blotto: could not open %s\n", argv[1]);
+        return 1;
+    }
 
-    if ((r1->wins/r1->games) > (r2->wins/r2->games))
+    //check if second argument is win, score or both
+    else if (argv[2] == NULL || (strcmp(argv[2], "win") != 0 && strcmp(argv[2], "score") != 0 && strcmp(argv[2], "both") != 0))
     {
-        return -1;
+        if (matchup_file != NULL)
+        {
+            fclose(matchup_file);
+        }
+        fprintf(stderr, "Blotto: missing 'win' or 'score'\n");
+        return 1;
     }
 
-    else if ((r1->wins/r1->games) < (r2->wins/r2->games))
+    //check is distribution present
+    else if (argv[3] == NULL && !weightings)
     {
+        if (matchup_file != NULL)
+        {
+            fclose(matchup_file);
+        }
+        fprintf(stderr, "Blotto: missing distribution\n");
         return 1;
     }
 
-    else
+    //weights come from the command line or from a file, not both
+    else if (argv[3] != NULL && weightings)
+    {
+        if (matchup_file != NULL)
+        {
+            fclose(matchup_file);
+        }
+        fprintf(stderr, "Blotto: weights given both on the command line and with --weights\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+void print_rankings(blotto_results *results, char *argv[], bool query, bool estimated, const char *heading)
+{
+    bool both = (strcmp(argv[2], "both") == 0);
+    if (!both && heading == NULL)
     {
-        return strcmp(r1->id, r2->id);
+        print_results(results, (strcmp(argv[2], "win") == 0), query, estimated);
+        return;
+    }
+
+    //the rankings by wins and by score can come from one run
+    const char *orders[] = {"win", "score"};
+    for (int i = 0; i < 2; i++)
+    {
+        if (both || strcmp(argv[2], orders[i]) == 0)
+        {
+            printf("# %s%s%s\n", (heading != NULL ? heading : ""), (heading != NULL ? ": " : ""), orders[i]);
+            print_results(results, (i == 0), query, estimated);
+        }
     }
 }
 
-int cmpfunc_score(const void *key1, const void *key2)
+void print_results(blotto_results *results, bool by_wins, bool query, bool estimated)
 {
-    //declares const void as result*
-    result *r1 = (result*)key1;
-    result *r2 = (result*)key2;
+    stats_switch(PHASE_SORTING);
+    blotto_results_sort(results, (by_wins ? BLOTTO_BY_WINS : BLOTTO_BY_SCORE));
+    stats_switch(PHASE_OUTPUT);
 
-    if ((r1->overall_score/r1->games) > (r2->overall_score/r2->games))
+    for (size_t i = 0; i < blotto_results_size(results); i++)
     {
-        return -1;
+        const blotto_standing *s = blotto_results_get(results, i);
+
+        //candidates get their win rate, then average score
+        if (query)
+        {
+            printf("%7.3f %7.3f %s\n", (s->wins/s->games), (s->overall_score/s->games), s->id);
+        }
+
+        //estimates get the margin of their interval after the value
+        else if (estimated)
+        {
+            printf("%7.3f %6.3f %s\n", (by_wins ? s->wins : s->overall_score) / s->games, (by_wins ? s->wins_margin : s->score_margin), s->id);
+        }
+
+        //in case of win
+        else if (by_wins)
+        {
+            printf("%7.3f %s\n", (s->wins/s->games), s->id);
+        }
+
+        //in case of score
+        else
+        {
+            printf("%7.3f %s\n", (s->overall_score/s->games), s->id);
+        }
     }
+}
 
-    else if ((r1->overall_score/r1->games) < (r2->overall_score/r2->games))
+double *parse_weights(char *argv[], int battlefields)
+{
+    double *weights = malloc(sizeof(double) * battlefields);
+    for (int i = 0; i < battlefields; i++)
     {
-        return 1;
+        weights[i] = atof(argv[i + 3]);
     }
 
-    else
+    return weights;
+}
+
+char *read_file(FILE *in, size_t *len)
+{
+    size_t capacity = 4096;
+    char *buffer = malloc(capacity);
+    *len = 0;
+    while (buffer != NULL)
     {
-        return strcmp(r1->id, r2->id);
+        *len += fread(buffer + *len, 1, capacity - *len, in);
+        if (*len < capacity)
+        {
+            break;
+        }
+
+        capacity *= 2;
+        char *bigger = realloc(buffer, capacity);
+        if (bigger == NULL)
+        {
+            free(buffer);
+        }
+        buffer = bigger;
     }
+
+    return buffer;
 }
 
-void free_fnc(gmap *all_players)
+double *read_weightings(FILE *in, int *battlefields, size_t *k)
 {
-    //function for freeing first gmap
-    const char **key_arr = (const char**) gmap_keys(all_players);
+    size_t capacity = 64;
+    double *weightings = malloc(sizeof(double) * capacity);
+    size_t count = 0;
+    *battlefields = 0;
+    *k = 0;
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    bool ok = (weightings != NULL);
+    while (ok && getline(&line, &line_capacity, in) != -1)
+    {
+        //each weight must be a positive number, and each line must have as many as the first
+        int fields = 0;
+        char *pos = line;
+        char *end;
+        double weight;
+        while (ok && (weight = strtod(pos, &end), end != pos))
+        {
+            if (count == capacity)
+            {
+                capacity *= 2;
+                double *bigger = realloc(weightings, sizeof(double) * capacity);
+                if (bigger == NULL)
+                {
+                    ok = false;
+                    break;
+                }
+                weightings = bigger;
+            }
+            ok = (weight > 0 && isfinite(weight));
+            weightings[count++] = weight;
+            fields++;
+            pos = end;
+        }
+        while (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')
+        {
+            pos++;
+        }
+
+        //blank lines are skipped
+        if (ok && fields > 0)
+        {
+            ok = (*pos == '\0' && (*k == 0 || fields == *battlefields));
+            *battlefields = fields;
+            (*k)++;
+        }
+        else if (ok)
+        {
+            ok = (*pos == '\0');
+        }
+    }
+    free(line);
+
+    if (!ok || *k == 0)
+    {
+        free(weightings);
+        return NULL;
+    }
+    return weightings;
+}
 
-    for (size_t i = 0; i < gmap_size(all_players); i++)
+bool parse_schedule(const char *arg, blotto_schedule *plan)
+{
+    const char *names[] = {"swiss:", "random:", "groups:"};
+    blotto_schedule_kind kinds[] = {BLOTTO_SCHEDULE_SWISS, BLOTTO_SCHEDULE_RANDOM, BLOTTO_SCHEDULE_ROUND_ROBIN};
+    for (int i = 0; i < 3; i++)
     {
-        free(gmap_get(all_players, key_arr[i]));
+        size_t len = strlen(names[i]);
+        if (strncmp(arg, names[i], len) == 0)
+        {
+            //the size must be a positive integer and nothing else
+            char *end = NULL;
+            long size = strtol(arg + len, &end, 10);
+            if (end == arg + len || *end != '\0' || size <= 0)
+            {
+                return false;
+            }
+            plan->kind = kinds[i];
+            plan->size = size;
+            return true;
+        }
     }
 
-    free(key_arr);
-    gmap_destroy(all_players);
+    return false;
 }
 
-void free_fnc2(gmap *point_map)
+int write_matrix(int argc, char *argv[], const options *opts)
 {
-    //function for freeing second gmap
-    const char **key_arr = (const char**) gmap_keys(point_map);
+    //every argument left is the weight of a battlefield
+    int battlefields = argc - 1;
+    if (battlefields == 0)
+    {
+        fprintf(stderr, "Blotto: missing distribution\n");
+        exit(1);
+    }
+
+    double *weights = malloc(sizeof(double) * battlefields);
+    for (int i = 0; i < battlefields; i++)
+    {
+        if (atoi(argv[i + 1]) <= 0)
+        {
+            free(weights);
+            fprintf(stderr, "Blotto: distribution needs to be postive integers\n");
+            exit(1);
+        }
+        weights[i] = atof(argv[i + 1]);
+    }
+
+    blotto_error error;
+    blotto_field *field = blotto_field_load(stdin, battlefields, opts->threads, &error);
+    if (field != NULL)
+    {
+        error = blotto_export_matrix(field, weights, opts->matrix, opts->matrix_scores, opts->threads);
+        blotto_field_destroy(field);
+    }
+    free(weights);
 
-    for (size_t i = 0; i < gmap_size(point_map); i++)
+    if (error != BLOTTO_OK)
     {
-        free(((result *) gmap_get(point_map, key_arr[i]))->id);
-        free(gmap_get(point_map, key_arr[i]));
+        fprintf(stderr, "Blotto: %s\n", blotto_strerror(error));
+        exit(1);
     }
 
-    free(key_arr);
-    gmap_destroy(point_map);
-}
\ No newline at end of file
+    stats_switch(PHASE_NONE);
+    stats_dump(stderr);
+    return 0;
+}
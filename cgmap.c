@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "cgmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "gmap.h"
+
+//bytes per cache line, so neighbouring shards' locks do not share one
+#define CGMAP_CACHE_LINE 64
+
+//a gmap built with GMAP_DEBUG counts the probes of every search in the map
+//itself, so a search then changes its shard and has to hold it alone
+#ifdef GMAP_DEBUG
+#define CGMAP_SEARCH_LOCK(lock) pthread_rwlock_wrlock(lock)
+#else
+#define CGMAP_SEARCH_LOCK(lock) pthread_rwlock_rdlock(lock)
+#endif
+
+/**
+ * One independently locked part of the map
+ *
+ * @param map the keys of this shard
+ * @param lock taken for reading by lookups and for writing by changes
+ */
+typedef struct _cgmap_shard
+{
+    gmap *map;
+    pthread_rwlock_t lock;
+} cgmap_shard;
+
+/**
+ * A shard padded to a whole number of cache lines
+ */
+typedef union _cgmap_slot
+{
+    cgmap_shard shard;
+    char pad[((sizeof(cgmap_shard) + CGMAP_CACHE_LINE - 1) / CGMAP_CACHE_LINE) * CGMAP_CACHE_LINE];
+} cgmap_slot;
+
+/**
+ * @param slots the shards
+ * @param num_shards the number of shards, a power of two
+ * @param shift how far to shift a mixed hash so its top bits pick a shard
+ * @param hash the hash function used for the keys
+ */
+struct _cgmap
+{
+    cgmap_slot *slots;
+    size_t num_shards;
+    int shift;
+    size_t (*hash)(const void *);
+};
+
+cgmap_shard *cgmap_shard_for(const cgmap *m, const void *key);
+void cgmap_store_key_in_array(const void *key, void *value, void *arg);
+
+cgmap *cgmap_create(void *(*cp)(const void *), int (*comp)(const void *, const void *), size_t (*h)(const void *s), void (*f)(void *), size_t shards)
+{
+    if (cp == NULL || comp == NULL || h == NULL || f == NULL || shards == 0)
+    {
+        return NULL;
+    }
+
+    cgmap *result = malloc(sizeof(cgmap));
+    if (result == NULL)
+    {
+        return NULL;
+    }
+
+    //round the number of shards up to a power of two
+    result->num_shards = 1;
+    result->shift = 64;
+    while (result->num_shards < shards)
+    {
+        result->num_shards *= 2;
+        result->shift--;
+    }
+    result->hash = h;
+
+    result->slots = malloc(sizeof(cgmap_slot) * result->num_shards);
+    if (result->slots == NULL)
+    {
+        free(result);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < result->num_shards; i++)
+    {
+        cgmap_shard *s = &result->slots[i].shard;
+        s->map = gmap_create(cp, comp, h, f);
+        if (s->map == NULL || pthread_rwlock_init(&s->lock, NULL) != 0)
+        {
+            //undo the shards made so far
+            gmap_destroy(s->map);
+            for (size_t j = 0; j < i; j++)
+            {
+                gmap_destroy(result->slots[j].shard.map);
+                pthread_rwlock_destroy(&result->slots[j].shard.lock);
+            }
+            free(result->slots);
+            free(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+//function for finding the shard of a key
+cgmap_shard *cgmap_shard_for(const cgmap *m, const void *key)
+{
+    if (m->num_shards == 1)
+    {
+        return &m->slots[0].shard;
+    }
+
+    //gmap indexes chains by the hash modulo its capacity, so the shard is
+    //taken from the top bits of a multiplicatively mixed hash instead
+    uint64_t mixed = (uint64_t) m->hash(key) * 0x9E3779B97F4A7C15ULL;
+    return &m->slots[mixed >> m->shift].shard;
+}
+
+size_t cgmap_size(cgmap *m)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < m->num_shards; i++)
+    {
+        cgmap_shard *s = &m->slots[i].shard;
+        pthread_rwlock_rdlock(&s->lock);
+        size += gmap_size(s->map);
+        pthread_rwlock_unlock(&s->lock);
+    }
+
+    return size;
+}
+
+void *cgmap_put(cgmap *m, const void *key, void *value)
+{
+    cgmap_shard *s = cgmap_shard_for(m, key);
+    pthread_rwlock_wrlock(&s->lock);
+    void *old = gmap_put(s->map, key, value);
+    pthread_rwlock_unlock(&s->lock);
+
+    return old;
+}
+
+void *cgmap_compute(cgmap *m, const void *key, void *(*f)(const void *, void *, void *), void *arg)
+{
+    cgmap_shard *s = cgmap_shard_for(m, key);
+    pthread_rwlock_wrlock(&s->lock);
+
+    void *old = gmap_get(s->map, key);
+    void *value = f(key, old, arg);
+
+    //store the new value if it changed or the key is new
+    if ((old != NULL || value != NULL) && value != old && gmap_put(s->map, key, value) == gmap_error)
+    {
+        value = gmap_error;
+    }
+
+    pthread_rwlock_unlock(&s->lock);
+
+    return value;
+}
+
+void *cgmap_remove(cgmap *m, const void *key)
+{
+    cgmap_shard *s = cgmap_shard_for(m, key);
+    pthread_rwlock_wrlock(&s->lock);
+    void *value = gmap_remove(s->map, key);
+    pthread_rwlock_unlock(&s->lock);
+
+    return value;
+}
+
+bool cgmap_contains_key(cgmap *m, const void *key)
+{
+    cgmap_shard *s = cgmap_shard_for(m, key);
+    CGMAP_SEARCH_LOCK(&s->lock);
+    bool found = gmap_contains_key(s->map, key);
+    pthread_rwlock_unlock(&s->lock);
+
+    return found;
+}
+
+void *cgmap_get(cgmap *m, const void *key)
+{
+    cgmap_shard *s = cgmap_shard_for(m, key);
+    CGMAP_SEARCH_LOCK(&s->lock);
+    void *value = gmap_get(s->map, key);
+    pthread_rwlock_unlock(&s->lock);
+
+    return value;
+}
+
+void cgmap_for_each(cgmap *m, void (*f)(const void *, void *, void *), void *arg)
+{
+    for (size_t i = 0; i < m->num_shards; i++)
+    {
+        cgmap_shard *s = &m->slots[i].shard;
+        pthread_rwlock_rdlock(&s->lock);
+        gmap_for_each(s->map, f, arg);
+        pthread_rwlock_unlock(&s->lock);
+    }
+}
+
+/**
+ * A location in an array where a key can be stored, as in gmap.c
+ */
+typedef struct _cgmap_store_location
+{
+    const void **arr;
+    size_t index;
+} cgmap_store_location;
+
+void cgmap_store_key_in_array(const void *key, void *value, void *arg)
+{
+    cgmap_store_location *where = arg;
+    where->arr[where->index] = key;
+    where->index++;
+}
+
+const void **cgmap_keys(cgmap *m)
+{
+    const void **keys = malloc(sizeof(*keys) * (cgmap_size(m) + 1));
+
+    if (keys != NULL)
+    {
+        cgmap_store_location loc = {keys, 0};
+        cgmap_for_each(m, cgmap_store_key_in_array, &loc);
+    }
+
+    return keys;
+}
+
+void cgmap_destroy(cgmap *m)
+{
+    if (m == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m->num_shards; i++)
+    {
+        gmap_destroy(m->slots[i].shard.map);
+        pthread_rwlock_destroy(&m->slots[i].shard.lock);
+    }
+
+    free(m->slots);
+    free(m);
+}
@@ -0,0 +1,139 @@
+#ifndef __CGMAP_H__
+#define __CGMAP_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+struct _cgmap;
+typedef struct _cgmap cgmap;
+
+/**
+ * Creates an empty map that can be used by several threads at once.  The
+ * map is split into shards, each a gmap with its own lock, and every key
+ * belongs to the shard chosen by the high bits of its hash.  Threads
+ * working on different shards never wait for each other, and each shard
+ * grows its own table.  Operations on one shard by several readers run
+ * concurrently; an operation that changes a shard runs alone on it.  When
+ * cgmap.c and gmap.c are compiled with GMAP_DEBUG, every search records
+ * its probes in the shard, so searches also run alone on their shard.
+ * The library does not use it yet: the field's players are added by one
+ * thread in the order they were read, and each thread that scores writes
+ * only results of its own, so only gmap_bench builds with it for now.
+ *
+ * @param cp a function that take a pointer to a key and returns a pointer to a deep copy of that key
+ * @param comp a pointer to a function that takes two keys and returns the result of comparing them,
+ * with return value as for strcmp
+ * @param h a pointer to a function that takes a pointer to a key and returns its hash code
+ * @param f a pointer to a function that takes a pointer to a copy of a key make by cp and frees it
+ * @param shards the number of shards, rounded up to a power of two
+ * @return a pointer to the new map or NULL if it could not be created;
+ * it is the caller's responsibility to destroy the map
+ */
+cgmap *cgmap_create(void *(*cp)(const void *), int (*comp)(const void *, const void *), size_t (*h)(const void *s), void (*f)(void *), size_t shards);
+
+
+/**
+ * Returns the number of (key, value) pairs in the given map.  Pairs added
+ * or removed by other threads during the call may or may not be counted.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @return the size of the map pointed to by m
+ */
+size_t cgmap_size(cgmap *m);
+
+
+/**
+ * Adds a copy of the given key with value to this map, as for gmap_put.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param key a pointer to a key, non-NULL
+ * @param value a pointer to a value
+ * @return a pointer to the old value, or NULL, or a pointer to gmap_error
+ */
+void *cgmap_put(cgmap *m, const void *key, void *value);
+
+
+/**
+ * Replaces the value associated with the given key by the value returned
+ * by the given function, which is called with the key, the current value
+ * (NULL if the key is not present) and the extra argument.  If the key is
+ * not present and the function returns non-NULL, the key is added.  No
+ * other thread can use the key's shard while the function runs, so this
+ * is how a value is read and changed, or added if absent, atomically.
+ * The function must not use the map.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param key a pointer to a key, non-NULL
+ * @param f a pointer to a function that returns the new value, non-NULL
+ * @param arg a pointer passed to f
+ * @return the value returned by f, or a pointer to gmap_error if the key
+ * could not be added
+ */
+void *cgmap_compute(cgmap *m, const void *key, void *(*f)(const void *, void *, void *), void *arg);
+
+
+/**
+ * Removes the given key from this map, as for gmap_remove.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param key a key, non-NULL
+ * @return the value associated with the removed key, or NULL
+ */
+void *cgmap_remove(cgmap *m, const void *key);
+
+
+/**
+ * Determines if the given key is present in this map.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param key a pointer to a key, non-NULL
+ * @return true if a key equal to the one pointed to is present in this map,
+ * false otherwise
+ */
+bool cgmap_contains_key(cgmap *m, const void *key);
+
+
+/**
+ * Returns the value associated with the given key in this map, or NULL if
+ * the key is not present.  Another thread may change the value once this
+ * returns; use cgmap_compute to change a value safely.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param key a pointer to a key, non-NULL
+ * @return a pointer to the assocated value, or NULL if they key is not present
+ */
+void *cgmap_get(cgmap *m, const void *key);
+
+
+/**
+ * Calls the given function for each (key, value) pair in this map, one
+ * shard at a time, as for gmap_for_each.  Each shard is locked against
+ * changes while its pairs are visited.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param f a pointer to a function that takes a key, a value, and an
+ * extra piece of information, and does not use the map, non-NULL
+ * @param arg a pointer
+ */
+void cgmap_for_each(cgmap *m, void (*f)(const void *, void *, void *), void *arg);
+
+
+/**
+ * Returns an array containing pointers to all of the keys in the given
+ * map, as for gmap_keys.  The map must not be changed during the call.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @return a pointer to an array of pointers to the keys, or NULL
+ */
+const void **cgmap_keys(cgmap *m);
+
+
+/**
+ * Destroys the given map.  There is no effect if the given pointer is NULL.
+ * No other thread may be using the map.
+ *
+ * @param m a pointer to a map, or NULL
+ */
+void cgmap_destroy(cgmap *m);
+
+#endif
@@ -0,0 +1,404 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+//identifies a snapshot file and the version of its layout
+#define CHECKPOINT_MAGIC "BLOTTOC2"
+
+//written as a number so a snapshot read on a machine of the other byte order is rejected
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+
+/**
+ * A player's results as a snapshot holds them
+ *
+ * @param id the player's id, which is not copied
+ * @param values the wins, overall score and games
+ */
+typedef struct _checkpoint_entry
+{
+    const char *id;
+    double values[3];
+} checkpoint_entry;
+
+/**
+ * A snapshot, written as the header, the number of players and each
+ * player's id length, id, wins, overall score and games; the header is the
+ * magic, the byte-order mark, the offset, what identifies the matchup file,
+ * the battlefields, the weights and the field size
+ *
+ * @param bytes the header as it is written
+ * @param size the number of bytes in the header
+ * @param capacity the room in bytes
+ * @param entries the players' results, laid out only when written
+ * @param players the number of players added
+ * @param room the number of players there is room for
+ */
+struct _checkpoint
+{
+    char *bytes;
+    size_t size;
+    size_t capacity;
+    checkpoint_entry *entries;
+    uint64_t players;
+    size_t room;
+};
+
+/**
+ * @param path the file snapshots are saved to
+ * @param lock guards pending, busy and failed
+ * @param wake signalled when there is a snapshot to write or the writer should stop
+ * @param pending the snapshot waiting to be written, or NULL
+ * @param busy true from when a snapshot is taken until it is written
+ * @param stopping true when the writer should stop once it is idle
+ * @param failed true if a snapshot could not be written
+ * @param thread the thread writing snapshots
+ */
+struct _checkpointer
+{
+    const char *path;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    checkpoint *pending;
+    bool busy;
+    bool stopping;
+    bool failed;
+    pthread_t thread;
+};
+
+bool checkpoint_append(checkpoint *c, const void *data, size_t len);
+bool checkpoint_same_source(const checkpoint_source *a, const checkpoint_source *b);
+bool checkpoint_take(FILE *in, void *data, size_t len);
+void *checkpointer_run(void *arg);
+bool checkpointer_write(const char *path, const checkpoint *c);
+bool checkpointer_write_players(FILE *out, const checkpoint *c);
+
+bool checkpoint_identify(FILE *in, checkpoint_source *source)
+{
+    struct stat info;
+    int fd = fileno(in);
+    if (fd == -1 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return false;
+    }
+
+    //every field is set so the struct can be written out whole
+    memset(source, 0, sizeof(checkpoint_source));
+    source->size = info.st_size;
+    source->modified = info.st_mtim.tv_sec;
+    source->modified_ns = info.st_mtim.tv_nsec;
+    source->device = info.st_dev;
+    source->inode = info.st_ino;
+    return true;
+}
+
+//function for checking that two matchup files are the same file, unchanged
+bool checkpoint_same_source(const checkpoint_source *a, const checkpoint_source *b)
+{
+    return a->size == b->size && a->modified == b->modified && a->modified_ns == b->modified_ns
+        && a->device == b->device && a->inode == b->inode;
+}
+
+checkpoint *checkpoint_create(long offset, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size)
+{
+    checkpoint *c = malloc(sizeof(checkpoint));
+    if (c == NULL)
+    {
+        return NULL;
+    }
+    c->capacity = 4096;
+    c->size = 0;
+    c->players = 0;
+    c->room = (field_size > 0 ? field_size : 1);
+    c->bytes = malloc(c->capacity);
+    c->entries = malloc(sizeof(checkpoint_entry) * c->room);
+    if (c->bytes == NULL || c->entries == NULL)
+    {
+        checkpoint_destroy(c);
+        return NULL;
+    }
+
+    uint32_t order = CHECKPOINT_BYTE_ORDER;
+    int64_t at = offset;
+    uint32_t count = battlefields;
+    uint64_t size = field_size;
+    bool ok = checkpoint_append(c, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC))
+        && checkpoint_append(c, &order, sizeof(order))
+        && checkpoint_append(c, &at, sizeof(at))
+        && checkpoint_append(c, source, sizeof(checkpoint_source))
+        && checkpoint_append(c, &count, sizeof(count))
+        && checkpoint_append(c, weights, sizeof(double) * battlefields)
+        && checkpoint_append(c, &size, sizeof(size));
+    if (!ok)
+    {
+        checkpoint_destroy(c);
+        return NULL;
+    }
+
+    return c;
+}
+
+bool checkpoint_add(checkpoint *c, const char *id, double wins, double overall_score, double games)
+{
+    if (c->players == c->room)
+    {
+        checkpoint_entry *bigger = realloc(c->entries, sizeof(checkpoint_entry) * c->room * 2);
+        if (bigger == NULL)
+        {
+            return false;
+        }
+        c->entries = bigger;
+        c->room *= 2;
+    }
+
+    //only the values are copied here, and the id is laid out with them by the writer
+    checkpoint_entry *e = &c->entries[c->players];
+    e->id = id;
+    e->values[0] = wins;
+    e->values[1] = overall_score;
+    e->values[2] = games;
+    c->players++;
+    return true;
+}
+
+void checkpoint_destroy(checkpoint *c)
+{
+    free(c->bytes);
+    free(c->entries);
+    free(c);
+}
+
+bool checkpoint_append(checkpoint *c, const void *data, size_t len)
+{
+    if (c->size + len > c->capacity)
+    {
+        size_t capacity = c->capacity;
+        while (c->size + len > capacity)
+        {
+            capacity *= 2;
+        }
+        char *bigger = realloc(c->bytes, capacity);
+        if (bigger == NULL)
+        {
+            return false;
+        }
+        c->bytes = bigger;
+        c->capacity = capacity;
+    }
+
+    memcpy(c->bytes + c->size, data, len);
+    c->size += len;
+    return true;
+}
+
+checkpoint_status checkpoint_read(const char *path, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size, long *offset,
+                                  bool (*f)(const char *, double, double, double, void *), void *arg)
+{
+    FILE *in = fopen(path, "rb");
+    if (in == NULL)
+    {
+        return CHECKPOINT_MISSING;
+    }
+
+    //the header must match this run exactly, and the offset must be within the matchup file
+    char magic[sizeof(CHECKPOINT_MAGIC)] = "";
+    uint32_t order;
+    int64_t at;
+    checkpoint_source taken;
+    uint32_t count;
+    uint64_t size;
+    uint64_t players;
+    bool ok = checkpoint_take(in, magic, strlen(CHECKPOINT_MAGIC))
+        && strcmp(magic, CHECKPOINT_MAGIC) == 0
+        && checkpoint_take(in, &order, sizeof(order)) && order == CHECKPOINT_BYTE_ORDER
+        && checkpoint_take(in, &at, sizeof(at)) && at >= 0
+        && checkpoint_take(in, &taken, sizeof(taken)) && checkpoint_same_source(&taken, source)
+        && (uint64_t) at <= source->size
+        && checkpoint_take(in, &count, sizeof(count)) && count == (uint32_t) battlefields;
+    for (int i = 0; ok && i < battlefields; i++)
+    {
+        double weight;
+        ok = checkpoint_take(in, &weight, sizeof(weight)) && weight == weights[i];
+    }
+    ok = ok && checkpoint_take(in, &size, sizeof(size)) && size == field_size
+        && checkpoint_take(in, &players, sizeof(players)) && players <= field_size;
+
+    char id[UINT8_MAX + 1];
+    for (uint64_t i = 0; ok && i < players; i++)
+    {
+        uint8_t id_len;
+        double values[3];
+        ok = checkpoint_take(in, &id_len, sizeof(id_len)) && checkpoint_take(in, id, id_len)
+            && checkpoint_take(in, values, sizeof(values));
+        id[ok ? id_len : 0] = '\0';
+        ok = ok && f(id, values[0], values[1], values[2], arg);
+    }
+
+    //nothing may follow the last player
+    ok = ok && fgetc(in) == EOF;
+    fclose(in);
+
+    *offset = at;
+    return (ok ? CHECKPOINT_OK : CHECKPOINT_INVALID);
+}
+
+bool checkpoint_take(FILE *in, void *data, size_t len)
+{
+    return fread(data, 1, len, in) == len;
+}
+
+checkpointer *checkpointer_create(const char *path)
+{
+    checkpointer *w = malloc(sizeof(checkpointer));
+    if (w == NULL)
+    {
+        return NULL;
+    }
+
+    w->path = path;
+    w->pending = NULL;
+    w->busy = false;
+    w->stopping = false;
+    w->failed = false;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    if (pthread_create(&w->thread, NULL, checkpointer_run, w) != 0)
+    {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->wake);
+        free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+bool checkpointer_idle(checkpointer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    bool idle = !w->busy;
+    pthread_mutex_unlock(&w->lock);
+    return idle;
+}
+
+bool checkpointer_submit(checkpointer *w, checkpoint *c)
+{
+    pthread_mutex_lock(&w->lock);
+    bool taken = !w->busy;
+    if (taken)
+    {
+        w->pending = c;
+        w->busy = true;
+        pthread_cond_signal(&w->wake);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (!taken)
+    {
+        checkpoint_destroy(c);
+    }
+    return taken;
+}
+
+bool checkpointer_destroy(checkpointer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    w->stopping = true;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->thread, NULL);
+    bool ok = !w->failed;
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    free(w);
+
+    return ok;
+}
+
+//writes each snapshot handed over until told to stop, finishing any pending one first
+void *checkpointer_run(void *arg)
+{
+    checkpointer *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    while (true)
+    {
+        while (w->pending == NULL && !w->stopping)
+        {
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        if (w->pending == NULL)
+        {
+            break;
+        }
+
+        checkpoint *c = w->pending;
+        w->pending = NULL;
+        pthread_mutex_unlock(&w->lock);
+
+        bool written = checkpointer_write(w->path, c);
+        checkpoint_destroy(c);
+
+        pthread_mutex_lock(&w->lock);
+        w->failed = w->failed || !written;
+        w->busy = false;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+
+bool checkpointer_write(const char *path, const checkpoint *c)
+{
+    //the snapshot replaces the old one only once it is whole
+    size_t len = strlen(path);
+    char *temporary = malloc(len + 5);
+    if (temporary == NULL)
+    {
+        return false;
+    }
+    strcpy(temporary, path);
+    strcpy(temporary + len, ".tmp");
+
+    //the snapshot is on disk before it replaces the old one, so a crash cannot leave the file empty
+    FILE *out = fopen(temporary, "wb");
+    bool ok = (out != NULL && fwrite(c->bytes, 1, c->size, out) == c->size && checkpointer_write_players(out, c));
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if (out != NULL)
+    {
+        ok = (fclose(out) == 0) && ok;
+    }
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok)
+    {
+        remove(temporary);
+    }
+
+    free(temporary);
+    return ok;
+}
+
+//function for laying out the players' results after the header, which is done on the writer's thread rather than the player's
+bool checkpointer_write_players(FILE *out, const checkpoint *c)
+{
+    bool ok = fwrite(&c->players, sizeof(c->players), 1, out) == 1;
+    for (uint64_t i = 0; ok && i < c->players; i++)
+    {
+        const checkpoint_entry *e = &c->entries[i];
+        size_t len = strlen(e->id);
+        uint8_t id_len = len;
+        ok = len <= UINT8_MAX && fwrite(&id_len, sizeof(id_len), 1, out) == 1
+            && fwrite(e->id, 1, len, out) == len && fwrite(e->values, sizeof(e->values), 1, out) == 1;
+    }
+
+    return ok;
+}
@@ -0,0 +1,155 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct _checkpoint;
+typedef struct _checkpoint checkpoint;
+
+struct _checkpointer;
+typedef struct _checkpointer checkpointer;
+
+//outcomes of reading a checkpoint
+typedef enum checkpoint_status {CHECKPOINT_OK, CHECKPOINT_MISSING, CHECKPOINT_INVALID} checkpoint_status;
+
+/**
+ * What identifies a matchup file, so that a snapshot is only resumed
+ * against the file it was taken of, unchanged since
+ *
+ * @param size the size of the file in bytes
+ * @param modified the seconds of the time the file was last modified
+ * @param modified_ns the nanoseconds of that time
+ * @param device the device the file is on
+ * @param inode the file's number on its device
+ */
+typedef struct _checkpoint_source
+{
+    uint64_t size;
+    int64_t modified;
+    int64_t modified_ns;
+    uint64_t device;
+    uint64_t inode;
+} checkpoint_source;
+
+/**
+ * Finds what identifies the file a stream reads.
+ *
+ * @param in a stream, non-NULL
+ * @param source a pointer to where to store what identifies the file, non-NULL
+ * @return true if the stream reads a regular file, false otherwise
+ */
+bool checkpoint_identify(FILE *in, checkpoint_source *source);
+
+
+/**
+ * Starts a snapshot of a run that has read the given number of bytes of
+ * its matchup file.  The matchup file, the weights and the field's size
+ * are recorded so that a run with different ones cannot resume from the
+ * snapshot.
+ *
+ * @param offset the number of bytes of the matchup file already played
+ * @param source a pointer to what identifies the matchup file, non-NULL
+ * @param battlefields the number of battlefields, positive
+ * @param weights the weight of each battlefield, non-NULL
+ * @param field_size the number of players in the field
+ * @return a pointer to the new snapshot, or NULL if there was an allocation error
+ */
+checkpoint *checkpoint_create(long offset, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size);
+
+
+/**
+ * Adds a player's accumulated results to the given snapshot.  Only the
+ * results are copied; the id is laid out with them when the snapshot is
+ * written, so taking a snapshot costs its caller a copy of three numbers
+ * per player.
+ *
+ * @param c a pointer to a snapshot, non-NULL
+ * @param id a pointer to a string of fewer than 256 characters, non-NULL,
+ * which must not change until the snapshot is destroyed
+ * @param wins the wins so far
+ * @param overall_score the total score so far
+ * @param games the number of games so far
+ * @return true if the results were added, false if there was an allocation error
+ */
+bool checkpoint_add(checkpoint *c, const char *id, double wins, double overall_score, double games);
+
+
+/**
+ * Destroys the given snapshot.
+ *
+ * @param c a pointer to a snapshot, non-NULL
+ */
+void checkpoint_destroy(checkpoint *c);
+
+
+/**
+ * Reads the snapshot in the given file, calling the given function with
+ * the results of each player in it.  The snapshot must have been made of
+ * the same matchup file, unchanged, with the same weights and field size,
+ * and its offset must be within the matchup file.
+ *
+ * @param path the name of the file, non-NULL
+ * @param source a pointer to what identifies the matchup file, non-NULL
+ * @param battlefields the number of battlefields, positive
+ * @param weights the weight of each battlefield, non-NULL
+ * @param field_size the number of players in the field
+ * @param offset a pointer to where to store the offset to resume from, non-NULL
+ * @param f a pointer to a function to call with each player's id, wins,
+ * overall score, games and arg; it returns false to stop reading
+ * @param arg a pointer passed to f
+ * @return CHECKPOINT_OK, CHECKPOINT_MISSING if there is no such file, or
+ * CHECKPOINT_INVALID if the file is not a snapshot of a run like this one
+ * or f returned false
+ */
+checkpoint_status checkpoint_read(const char *path, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size, long *offset,
+                                  bool (*f)(const char *, double, double, double, void *), void *arg);
+
+
+/**
+ * Creates a writer that saves snapshots to the given file on a thread of
+ * its own.  Each snapshot is written to a temporary file that is flushed
+ * to disk and then replaces the given one, so the file always holds a
+ * whole snapshot.
+ *
+ * @param path the name of the file, non-NULL, which must outlive the writer
+ * @return a pointer to the new writer, or NULL if it could not be created
+ */
+checkpointer *checkpointer_create(const char *path);
+
+
+/**
+ * Returns whether the given writer is done with the last snapshot it was
+ * given, so that a new one would be taken.
+ *
+ * @param w a pointer to a writer, non-NULL
+ * @return true if the writer is idle
+ */
+bool checkpointer_idle(checkpointer *w);
+
+
+/**
+ * Hands the given snapshot to the given writer, which destroys it once it
+ * is written.  The snapshot is dropped instead if the writer is still busy
+ * with an earlier one, so the caller never waits.
+ *
+ * @param w a pointer to a writer, non-NULL
+ * @param c a pointer to a snapshot, non-NULL, whose ids must not change
+ * until the writer is destroyed
+ * @return true if the writer took the snapshot
+ */
+bool checkpointer_submit(checkpointer *w, checkpoint *c);
+
+
+/**
+ * Waits for the given writer to finish the snapshot it is writing, then
+ * destroys it.
+ *
+ * @param w a pointer to a writer, non-NULL
+ * @return true if every snapshot the writer took was written
+ */
+bool checkpointer_destroy(checkpointer *w);
+
+#endif
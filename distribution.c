@@ -0,0 +1,798 @@
+#include "distribution.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "gmap.h"
+#include "string_key.h"
+
+//longest text of one battlefield value plus its separating comma
+#define DIST_MAX_DIGITS 12
+
+//initial number of classes the rows array can hold
+#define DIST_INITIAL_CAPACITY 64
+
+//pairings dist_table_score_row sums together, so that each sum does not wait on the one before
+#define DIST_ROW_GROUP 4
+
+//the high bit of each value in a word of 8 one-byte or 4 two-byte values
+#define DIST_HIGH_U8 0x8080808080808080ULL
+#define DIST_HIGH_U16 0x8000800080008000ULL
+
+//a one in the lowest bit of each value in a word of 8 one-byte or 4 two-byte values
+#define DIST_ONES_U8 0x0101010101010101ULL
+#define DIST_ONES_U16 0x0001000100010001ULL
+
+/**
+ * Unique distributions stored row after row in one array
+ *
+ * @param battlefields the number of values in each row
+ * @param width the number of bytes per value in rows (1, 2 or 4)
+ * @param rows the distributions of the classes, size * battlefields values
+ * @param counts the number of members of each class
+ * @param size the number of classes
+ * @param capacity the number of classes rows and counts can hold
+ * @param index a gmap from the text of a distribution to its class index
+ * @param key a buffer for building the text of a distribution
+ */
+struct _dist_table
+{
+    int battlefields;
+    int width;
+    void *rows;
+    size_t *counts;
+    size_t size;
+    size_t capacity;
+    gmap *index;
+    char *key;
+};
+
+void dist_table_make_key(const dist_table *t, const int *distribution);
+void dist_table_free_value(const void *key, void *value, void *arg);
+int dist_table_width_for(const int *distribution, int battlefields);
+bool dist_table_widen(dist_table *t, int width);
+void dist_table_store(void *rows, int width, size_t i, int value);
+int dist_table_load(const void *rows, int width, size_t i);
+void dist_compare_u8(const uint8_t *arr1, const uint8_t *arr2, int battlefields, signed char *outcomes);
+void dist_compare_u16(const uint16_t *arr1, const uint16_t *arr2, int battlefields, signed char *outcomes);
+void dist_compare_u32(const uint32_t *arr1, const uint32_t *arr2, int battlefields, signed char *outcomes);
+void dist_compare_u8_int(const uint8_t *arr1, const int *arr2, int battlefields, signed char *outcomes);
+void dist_compare_u16_int(const uint16_t *arr1, const int *arr2, int battlefields, signed char *outcomes);
+void dist_compare_u32_int(const uint32_t *arr1, const int *arr2, int battlefields, signed char *outcomes);
+void dist_score_row_u8(const uint8_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes);
+void dist_score_row_u16(const uint16_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes);
+void dist_score_row_u32(const uint32_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes);
+void dist_set_wins(pair_outcome *outcome);
+bool dist_uniform_half(const double *weights, size_t stride, int battlefields, double *half);
+void dist_uniform_row(const dist_table *t, size_t cls, const size_t *others, size_t n, double half, pair_outcome *outcomes);
+void dist_score_counts(int won, int tied, int battlefields, double half, pair_outcome *outcome);
+void dist_count_u8(const uint8_t *arr1, const uint8_t *arr2, int battlefields, int *won, int *tied);
+void dist_count_u16(const uint16_t *arr1, const uint16_t *arr2, int battlefields, int *won, int *tied);
+void dist_count_u32(const uint32_t *arr1, const uint32_t *arr2, int battlefields, int *won, int *tied);
+uint64_t dist_lanes_ge(uint64_t x, uint64_t y, uint64_t high);
+int dist_lanes_count(uint64_t mask, int shift, uint64_t ones, int top);
+
+dist_table *dist_table_create(int battlefields)
+{
+    if (battlefields <= 0)
+    {
+        return NULL;
+    }
+
+    dist_table *result = malloc(sizeof(dist_table));
+
+    if (result != NULL)
+    {
+        //start at the narrowest width and widen when a larger value is added
+        result->battlefields = battlefields;
+        result->width = 1;
+        result->size = 0;
+        result->capacity = DIST_INITIAL_CAPACITY;
+        result->rows = malloc(result->width * battlefields * result->capacity);
+        result->counts = malloc(sizeof(size_t) * result->capacity);
+        result->key = malloc(DIST_MAX_DIGITS * battlefields + 1);
+        result->index = gmap_create(duplicate, compare_keys, hash29, free);
+
+        if (result->rows == NULL || result->counts == NULL || result->key == NULL || result->index == NULL)
+        {
+            dist_table_destroy(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+size_t dist_table_size(const dist_table *t)
+{
+    return t->size;
+}
+
+int dist_table_battlefields(const dist_table *t)
+{
+    return t->battlefields;
+}
+
+int dist_table_width(const dist_table *t)
+{
+    return t->width;
+}
+
+//function for writing a distribution as text, which is the key of its class
+void dist_table_make_key(const dist_table *t, const int *distribution)
+{
+    char *end = t->key;
+    for (int i = 0; i < t->battlefields; i++)
+    {
+        end += sprintf(end, "%d,", distribution[i]);
+    }
+}
+
+//function for finding the narrowest width that holds every value of a distribution
+int dist_table_width_for(const int *distribution, int battlefields)
+{
+    int max = 0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        if (distribution[i] > max)
+        {
+            max = distribution[i];
+        }
+    }
+
+    if (max <= UINT8_MAX)
+    {
+        return 1;
+    }
+
+    else if (max <= UINT16_MAX)
+    {
+        return 2;
+    }
+
+    return 4;
+}
+
+//function for writing value i of a rows array of the given width
+void dist_table_store(void *rows, int width, size_t i, int value)
+{
+    if (width == 1)
+    {
+        ((uint8_t *) rows)[i] = value;
+    }
+
+    else if (width == 2)
+    {
+        ((uint16_t *) rows)[i] = value;
+    }
+
+    else
+    {
+        ((uint32_t *) rows)[i] = value;
+    }
+}
+
+//function for reading value i of a rows array of the given width
+int dist_table_load(const void *rows, int width, size_t i)
+{
+    if (width == 1)
+    {
+        return ((const uint8_t *) rows)[i];
+    }
+
+    else if (width == 2)
+    {
+        return ((const uint16_t *) rows)[i];
+    }
+
+    return ((const uint32_t *) rows)[i];
+}
+
+//function for copying all rows to a wider representation
+bool dist_table_widen(dist_table *t, int width)
+{
+    void *rows = malloc(width * t->battlefields * t->capacity);
+    if (rows == NULL)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < t->size * t->battlefields; i++)
+    {
+        dist_table_store(rows, width, i, dist_table_load(t->rows, t->width, i));
+    }
+
+    free(t->rows);
+    t->rows = rows;
+    t->width = width;
+
+    return true;
+}
+
+size_t dist_table_intern(dist_table *t, const int *distribution)
+{
+    dist_table_make_key(t, distribution);
+
+    size_t *cls = gmap_get(t->index, t->key);
+    if (cls != NULL)
+    {
+        //same distribution seen before
+        t->counts[*cls]++;
+        return *cls;
+    }
+
+    //make sure the new values fit in the current width
+    int width = dist_table_width_for(distribution, t->battlefields);
+    if (width > t->width && !dist_table_widen(t, width))
+    {
+        return DIST_TABLE_ERROR;
+    }
+
+    //make room for one more row
+    if (t->size == t->capacity)
+    {
+        void *rows = realloc(t->rows, t->width * t->battlefields * t->capacity * 2);
+        if (rows == NULL)
+        {
+            return DIST_TABLE_ERROR;
+        }
+        t->rows = rows;
+
+        size_t *counts = realloc(t->counts, sizeof(size_t) * t->capacity * 2);
+        if (counts == NULL)
+        {
+            return DIST_TABLE_ERROR;
+        }
+        t->counts = counts;
+
+        t->capacity *= 2;
+    }
+
+    cls = malloc(sizeof(size_t));
+    if (cls == NULL)
+    {
+        return DIST_TABLE_ERROR;
+    }
+
+    *cls = t->size;
+    if (gmap_put(t->index, t->key, cls) == gmap_error)
+    {
+        free(cls);
+        return DIST_TABLE_ERROR;
+    }
+
+    for (int i = 0; i < t->battlefields; i++)
+    {
+        dist_table_store(t->rows, t->width, *cls * t->battlefields + i, distribution[i]);
+    }
+    t->counts[*cls] = 1;
+    t->size++;
+
+    return *cls;
+}
+
+void dist_table_release(dist_table *t, size_t cls)
+{
+    t->counts[cls]--;
+}
+
+void dist_table_get(const dist_table *t, size_t cls, int *distribution)
+{
+    for (int i = 0; i < t->battlefields; i++)
+    {
+        distribution[i] = dist_table_load(t->rows, t->width, cls * t->battlefields + i);
+    }
+}
+
+size_t dist_table_count(const dist_table *t, size_t cls)
+{
+    return t->counts[cls];
+}
+
+/**
+ * Comparison kernels, one per storage width.  The loops are branch-free
+ * so the compiler can vectorize them; narrower widths fit more
+ * battlefields in each vector register.
+ */
+void dist_compare_u8(const uint8_t *arr1, const uint8_t *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = (arr1[i] > arr2[i]) - (arr1[i] < arr2[i]);
+    }
+}
+
+void dist_compare_u16(const uint16_t *arr1, const uint16_t *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = (arr1[i] > arr2[i]) - (arr1[i] < arr2[i]);
+    }
+}
+
+void dist_compare_u32(const uint32_t *arr1, const uint32_t *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = (arr1[i] > arr2[i]) - (arr1[i] < arr2[i]);
+    }
+}
+
+void dist_table_compare(const dist_table *t, size_t cls1, size_t cls2, signed char *outcomes)
+{
+    size_t n = t->battlefields;
+
+    if (t->width == 1)
+    {
+        dist_compare_u8((const uint8_t *) t->rows + cls1 * n, (const uint8_t *) t->rows + cls2 * n, n, outcomes);
+    }
+
+    else if (t->width == 2)
+    {
+        dist_compare_u16((const uint16_t *) t->rows + cls1 * n, (const uint16_t *) t->rows + cls2 * n, n, outcomes);
+    }
+
+    else
+    {
+        dist_compare_u32((const uint32_t *) t->rows + cls1 * n, (const uint32_t *) t->rows + cls2 * n, n, outcomes);
+    }
+}
+
+void dist_compare_u8_int(const uint8_t *arr1, const int *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = (arr1[i] > arr2[i]) - (arr1[i] < arr2[i]);
+    }
+}
+
+void dist_compare_u16_int(const uint16_t *arr1, const int *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = (arr1[i] > arr2[i]) - (arr1[i] < arr2[i]);
+    }
+}
+
+void dist_compare_u32_int(const uint32_t *arr1, const int *arr2, int battlefields, signed char *outcomes)
+{
+    for (int i = 0; i < battlefields; i++)
+    {
+        outcomes[i] = ((int) arr1[i] > arr2[i]) - ((int) arr1[i] < arr2[i]);
+    }
+}
+
+void dist_table_compare_to(const dist_table *t, size_t cls, const int *distribution, signed char *outcomes)
+{
+    size_t n = t->battlefields;
+
+    if (t->width == 1)
+    {
+        dist_compare_u8_int((const uint8_t *) t->rows + cls * n, distribution, n, outcomes);
+    }
+
+    else if (t->width == 2)
+    {
+        dist_compare_u16_int((const uint16_t *) t->rows + cls * n, distribution, n, outcomes);
+    }
+
+    else
+    {
+        dist_compare_u32_int((const uint32_t *) t->rows + cls * n, distribution, n, outcomes);
+    }
+}
+
+void score_shares(const double *weights, int battlefields, double *shares)
+{
+    //the same values score_matchup adds
+    for (int i = 0; i < battlefields; i++)
+    {
+        shares[3 * i] = 0.0;
+        shares[3 * i + 1] = weights[i] / 2;
+        shares[3 * i + 2] = weights[i];
+    }
+}
+
+void dist_table_score_row(const dist_table *t, size_t cls, const size_t *others, size_t n, const double *shares, pair_outcome *outcomes)
+{
+    //the full weights are every third share
+    double half;
+    if (dist_uniform_half(shares + 2, 3, t->battlefields, &half))
+    {
+        dist_uniform_row(t, cls, others, n, half, outcomes);
+    }
+
+    //the scores are looked up rather than branched on
+    else if (t->width == 1)
+    {
+        dist_score_row_u8((const uint8_t *) t->rows, cls, others, n, t->battlefields, shares, outcomes);
+    }
+
+    else if (t->width == 2)
+    {
+        dist_score_row_u16((const uint16_t *) t->rows, cls, others, n, t->battlefields, shares, outcomes);
+    }
+
+    else
+    {
+        dist_score_row_u32((const uint32_t *) t->rows, cls, others, n, t->battlefields, shares, outcomes);
+    }
+}
+
+void dist_score_row_u8(const uint8_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes)
+{
+    const uint8_t *arr1 = rows + cls * battlefields;
+    for (size_t j = 0; j < n; j += DIST_ROW_GROUP)
+    {
+        size_t group = (n - j < DIST_ROW_GROUP ? n - j : DIST_ROW_GROUP);
+        const uint8_t *arr2[DIST_ROW_GROUP];
+        double score1[DIST_ROW_GROUP] = {0.0};
+        double score2[DIST_ROW_GROUP] = {0.0};
+        for (size_t k = 0; k < group; k++)
+        {
+            arr2[k] = rows + others[j + k] * battlefields;
+        }
+
+        for (int i = 0; i < battlefields; i++)
+        {
+            for (size_t k = 0; k < group; k++)
+            {
+                score1[k] += shares[3 * i + (arr1[i] > arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+                score2[k] += shares[3 * i + (arr1[i] < arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+            }
+        }
+
+        for (size_t k = 0; k < group; k++)
+        {
+            outcomes[j + k].score1 = score1[k];
+            outcomes[j + k].score2 = score2[k];
+            dist_set_wins(&outcomes[j + k]);
+        }
+    }
+}
+
+void dist_score_row_u16(const uint16_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes)
+{
+    const uint16_t *arr1 = rows + cls * battlefields;
+    for (size_t j = 0; j < n; j += DIST_ROW_GROUP)
+    {
+        size_t group = (n - j < DIST_ROW_GROUP ? n - j : DIST_ROW_GROUP);
+        const uint16_t *arr2[DIST_ROW_GROUP];
+        double score1[DIST_ROW_GROUP] = {0.0};
+        double score2[DIST_ROW_GROUP] = {0.0};
+        for (size_t k = 0; k < group; k++)
+        {
+            arr2[k] = rows + others[j + k] * battlefields;
+        }
+
+        for (int i = 0; i < battlefields; i++)
+        {
+            for (size_t k = 0; k < group; k++)
+            {
+                score1[k] += shares[3 * i + (arr1[i] > arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+                score2[k] += shares[3 * i + (arr1[i] < arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+            }
+        }
+
+        for (size_t k = 0; k < group; k++)
+        {
+            outcomes[j + k].score1 = score1[k];
+            outcomes[j + k].score2 = score2[k];
+            dist_set_wins(&outcomes[j + k]);
+        }
+    }
+}
+
+void dist_score_row_u32(const uint32_t *rows, size_t cls, const size_t *others, size_t n, int battlefields, const double *shares, pair_outcome *outcomes)
+{
+    const uint32_t *arr1 = rows + cls * battlefields;
+    for (size_t j = 0; j < n; j += DIST_ROW_GROUP)
+    {
+        size_t group = (n - j < DIST_ROW_GROUP ? n - j : DIST_ROW_GROUP);
+        const uint32_t *arr2[DIST_ROW_GROUP];
+        double score1[DIST_ROW_GROUP] = {0.0};
+        double score2[DIST_ROW_GROUP] = {0.0};
+        for (size_t k = 0; k < group; k++)
+        {
+            arr2[k] = rows + others[j + k] * battlefields;
+        }
+
+        for (int i = 0; i < battlefields; i++)
+        {
+            for (size_t k = 0; k < group; k++)
+            {
+                score1[k] += shares[3 * i + (arr1[i] > arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+                score2[k] += shares[3 * i + (arr1[i] < arr2[k][i]) * 2 + (arr1[i] == arr2[k][i])];
+            }
+        }
+
+        for (size_t k = 0; k < group; k++)
+        {
+            outcomes[j + k].score1 = score1[k];
+            outcomes[j + k].score2 = score2[k];
+            dist_set_wins(&outcomes[j + k]);
+        }
+    }
+}
+
+bool uniform_weights(const double *weights, int battlefields, double *half)
+{
+    return dist_uniform_half(weights, 1, battlefields, half);
+}
+
+//function for checking the weights every stride values apart, as uniform_weights does
+bool dist_uniform_half(const double *weights, size_t stride, int battlefields, double *half)
+{
+    double weight = weights[0];
+    for (int i = 1; i < battlefields; i++)
+    {
+        if (weights[i * stride] != weight)
+        {
+            return false;
+        }
+    }
+
+    *half = weight / 2;
+    if (!(weight > 0) || !isfinite(weight * battlefields) || *half * 2 != weight)
+    {
+        return false;
+    }
+
+    //every sum score_matchup makes is at most 2 * battlefields halves, so
+    //it is exact when that many times the odd part of the half's mantissa fits in 53 bits
+    int exponent;
+    uint64_t odd = (uint64_t) ldexp(frexp(*half, &exponent), 53);
+    while ((odd & 1) == 0)
+    {
+        odd >>= 1;
+    }
+
+    return odd <= (1ULL << 53) / (2 * (uint64_t) battlefields);
+}
+
+void dist_table_score_uniform(const dist_table *t, size_t cls1, size_t cls2, double half, pair_outcome *outcome)
+{
+    dist_uniform_row(t, cls1, &cls2, 1, half, outcome);
+}
+
+//function for scoring a class against a run of classes when every battlefield has the same weight
+void dist_uniform_row(const dist_table *t, size_t cls, const size_t *others, size_t n, double half, pair_outcome *outcomes)
+{
+    size_t b = t->battlefields;
+    int won;
+    int tied;
+
+    //the width is settled once for the whole run
+    for (size_t j = 0; j < n && t->width == 1; j++)
+    {
+        dist_count_u8((const uint8_t *) t->rows + cls * b, (const uint8_t *) t->rows + others[j] * b, b, &won, &tied);
+        dist_score_counts(won, tied, b, half, &outcomes[j]);
+    }
+
+    for (size_t j = 0; j < n && t->width == 2; j++)
+    {
+        dist_count_u16((const uint16_t *) t->rows + cls * b, (const uint16_t *) t->rows + others[j] * b, b, &won, &tied);
+        dist_score_counts(won, tied, b, half, &outcomes[j]);
+    }
+
+    for (size_t j = 0; j < n && t->width == 4; j++)
+    {
+        dist_count_u32((const uint32_t *) t->rows + cls * b, (const uint32_t *) t->rows + others[j] * b, b, &won, &tied);
+        dist_score_counts(won, tied, b, half, &outcomes[j]);
+    }
+}
+
+void dist_score_counts(int won, int tied, int battlefields, double half, pair_outcome *outcome)
+{
+    //uniform_weights made sure these products are the exact sums score_matchup adds up
+    int lost = battlefields - won - tied;
+    outcome->score1 = (2 * won + tied) * half;
+    outcome->score2 = (2 * lost + tied) * half;
+
+    //the same wins dist_set_wins gives, without a branch the outcomes make hard to predict
+    outcome->wins1 = 0.5 * ((won >= lost) + (won > lost));
+}
+
+void dist_count_u8(const uint8_t *arr1, const uint8_t *arr2, int battlefields, int *won, int *tied)
+{
+    int wins = 0;
+    int ties = 0;
+    int i = 0;
+
+    //8 battlefields to a word, with the tail counted one at a time
+    for (; i + 8 <= battlefields; i += 8)
+    {
+        uint64_t x;
+        uint64_t y;
+        memcpy(&x, arr1 + i, sizeof(x));
+        memcpy(&y, arr2 + i, sizeof(y));
+        uint64_t ge1 = dist_lanes_ge(x, y, DIST_HIGH_U8);
+        uint64_t ge2 = dist_lanes_ge(y, x, DIST_HIGH_U8);
+        wins += dist_lanes_count(ge1 & ~ge2, 7, DIST_ONES_U8, 56);
+        ties += dist_lanes_count(ge1 & ge2, 7, DIST_ONES_U8, 56);
+    }
+    for (; i < battlefields; i++)
+    {
+        wins += (arr1[i] > arr2[i]);
+        ties += (arr1[i] == arr2[i]);
+    }
+
+    *won = wins;
+    *tied = ties;
+}
+
+void dist_count_u16(const uint16_t *arr1, const uint16_t *arr2, int battlefields, int *won, int *tied)
+{
+    int wins = 0;
+    int ties = 0;
+    int i = 0;
+
+    //4 battlefields to a word, with the tail counted one at a time
+    for (; i + 4 <= battlefields; i += 4)
+    {
+        uint64_t x;
+        uint64_t y;
+        memcpy(&x, arr1 + i, sizeof(x));
+        memcpy(&y, arr2 + i, sizeof(y));
+        uint64_t ge1 = dist_lanes_ge(x, y, DIST_HIGH_U16);
+        uint64_t ge2 = dist_lanes_ge(y, x, DIST_HIGH_U16);
+        wins += dist_lanes_count(ge1 & ~ge2, 15, DIST_ONES_U16, 48);
+        ties += dist_lanes_count(ge1 & ge2, 15, DIST_ONES_U16, 48);
+    }
+    for (; i < battlefields; i++)
+    {
+        wins += (arr1[i] > arr2[i]);
+        ties += (arr1[i] == arr2[i]);
+    }
+
+    *won = wins;
+    *tied = ties;
+}
+
+void dist_count_u32(const uint32_t *arr1, const uint32_t *arr2, int battlefields, int *won, int *tied)
+{
+    //only 2 values fit in a word, so these are counted one at a time
+    int wins = 0;
+    int ties = 0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        wins += (arr1[i] > arr2[i]);
+        ties += (arr1[i] == arr2[i]);
+    }
+
+    *won = wins;
+    *tied = ties;
+}
+
+//function for setting the high bit of each value of x that is no less than the value of y in the same place
+uint64_t dist_lanes_ge(uint64_t x, uint64_t y, uint64_t high)
+{
+    //with x's high bits set and y's cleared no value borrows from the next, and
+    //the high bit of each difference is set where x's low bits are no less than y's
+    uint64_t low_ge = (x | high) - (y & ~high);
+    return ((x & ~y) | (~(x ^ y) & low_ge)) & high;
+}
+
+//function for counting the lanes of a mask with their high bit set, adding the lanes up with one multiply
+int dist_lanes_count(uint64_t mask, int shift, uint64_t ones, int top)
+{
+    return (int) (((mask >> shift) * ones) >> top);
+}
+
+//the player with the higher score wins, ties split the win
+void dist_set_wins(pair_outcome *outcome)
+{
+    outcome->wins1 = (outcome->score1 > outcome->score2 ? 1.0 : (outcome->score1 == outcome->score2 ? 0.5 : 0.0));
+}
+
+void score_matchup(const signed char *outcomes, int battlefields, const double *weights, pair_outcome *outcome)
+{
+    outcome->score1 = 0.0;
+    outcome->score2 = 0.0;
+
+    for (int i = 0; i < battlefields; i++)
+    {
+        if (outcomes[i] > 0)
+        {
+            outcome->score1 += weights[i];
+        }
+
+        else if (outcomes[i] == 0)
+        {
+            outcome->score1 += (weights[i]/2);
+            outcome->score2 += (weights[i]/2);
+        }
+
+        else
+        {
+            outcome->score2 += weights[i];
+        }
+    }
+
+    //the player with the higher score wins, ties split the win
+    if (outcome->score1 > outcome->score2)
+    {
+        outcome->wins1 = 1.0;
+    }
+
+    else if (outcome->score1 == outcome->score2)
+    {
+        outcome->wins1 = 0.5;
+    }
+
+    else
+    {
+        outcome->wins1 = 0.0;
+    }
+}
+
+//function for freeing the class indices held as values of the index
+void dist_table_free_value(const void *key, void *value, void *arg)
+{
+    free(value);
+}
+
+double score_self_matchup(const double *weights, int battlefields)
+{
+    double score = 0.0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        score += (weights[i]/2);
+        score += (weights[i]/2);
+    }
+
+    return score;
+}
+
+void score_matchup_weightings(const signed char *outcomes, int battlefields, const double *weights, size_t k,
+                              double *restrict score1, double *restrict score2, double *restrict wins1)
+{
+    for (size_t j = 0; j < k; j++)
+    {
+        score1[j] = 0.0;
+        score2[j] = 0.0;
+    }
+
+    //each side's share of a battlefield is 1, 0.5 or 0, so the sums match score_matchup's exactly
+    for (int i = 0; i < battlefields; i++)
+    {
+        double share1 = (outcomes[i] > 0 ? 1.0 : (outcomes[i] == 0 ? 0.5 : 0.0));
+        double share2 = 1.0 - share1;
+        const double *row = weights + (size_t) i * k;
+
+        //the weightings are independent, so this loop is vectorized
+        for (size_t j = 0; j < k; j++)
+        {
+            score1[j] += row[j] * share1;
+            score2[j] += row[j] * share2;
+        }
+    }
+
+    for (size_t j = 0; j < k; j++)
+    {
+        wins1[j] = (score1[j] > score2[j] ? 1.0 : (score1[j] == score2[j] ? 0.5 : 0.0));
+    }
+}
+
+void dist_table_destroy(dist_table *t)
+{
+    if (t == NULL)
+    {
+        return;
+    }
+
+    if (t->index != NULL)
+    {
+        gmap_for_each(t->index, dist_table_free_value, NULL);
+        gmap_destroy(t->index);
+    }
+
+    free(t->rows);
+    free(t->counts);
+    free(t->key);
+    free(t);
+}
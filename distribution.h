@@ -0,0 +1,255 @@
+#ifndef __DISTRIBUTION_H__
+#define __DISTRIBUTION_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+struct _dist_table;
+typedef struct _dist_table dist_table;
+
+/**
+ * The outcome of a matchup between two distributions
+ *
+ * @param score1 the score the first distribution gets from the matchup
+ * @param score2 the score the second distribution gets from the matchup
+ * @param wins1 the wins given to the first distribution (1, 0.5 or 0), the second gets the rest
+ */
+typedef struct _pair_outcome
+{
+    double score1;
+    double score2;
+    double wins1;
+} pair_outcome;
+
+/**
+ * Returned by dist_table_intern to report an allocation error.
+ */
+#define DIST_TABLE_ERROR ((size_t) -1)
+
+/**
+ * Creates an empty table of distribution classes.  Identical distributions
+ * are stored once as a single class so that players submitting the same
+ * distribution can share it.  Values are stored in the narrowest unsigned
+ * width (8, 16 or 32 bits) that holds the largest value added so far.
+ *
+ * @param battlefields the number of battlefields in each distribution, positive
+ * @return a pointer to the new table or NULL if it could not be created;
+ * it is the caller's responsibility to destroy the table
+ */
+dist_table *dist_table_create(int battlefields);
+
+
+/**
+ * Returns the number of unique distributions in the given table.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @return the number of classes in the table
+ */
+size_t dist_table_size(const dist_table *t);
+
+
+/**
+ * Returns the number of battlefields in each distribution of the given table.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @return the number of battlefields
+ */
+int dist_table_battlefields(const dist_table *t);
+
+
+/**
+ * Adds a member with the given distribution to this table.  If an
+ * identical distribution is already present its class is reused,
+ * otherwise a new class is created holding a copy of the distribution.
+ * The caller retains ownership of the given array.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param distribution an array of battlefields non-negative integers, non-NULL
+ * @return the index of the distribution's class, or DIST_TABLE_ERROR
+ */
+size_t dist_table_intern(dist_table *t, const int *distribution);
+
+
+/**
+ * Removes a member from the given class.  The class keeps its index and
+ * its distribution even when it has no members left.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls the index of a class in the table with at least one member
+ */
+void dist_table_release(dist_table *t, size_t cls);
+
+
+/**
+ * Returns the number of bytes used to store each battlefield value.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @return 1, 2 or 4
+ */
+int dist_table_width(const dist_table *t);
+
+
+/**
+ * Copies the distribution of the given class into the given array.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls the index of a class in the table
+ * @param distribution an array with room for battlefields integers, non-NULL
+ */
+void dist_table_get(const dist_table *t, size_t cls, int *distribution);
+
+
+/**
+ * Compares the distributions of two classes battlefield by battlefield.
+ * Each entry of outcomes is set to 1 if the first class has more units on
+ * that battlefield, 0 if both have the same, and -1 if the second has more.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls1 the index of a class in the table
+ * @param cls2 the index of a class in the table
+ * @param outcomes an array with room for battlefields values, non-NULL
+ */
+void dist_table_compare(const dist_table *t, size_t cls1, size_t cls2, signed char *outcomes);
+
+
+/**
+ * Returns the number of members that were interned into the given class.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls the index of a class in the table
+ * @return the number of members of the class
+ */
+size_t dist_table_count(const dist_table *t, size_t cls);
+
+
+/**
+ * Compares the distribution of a class to a distribution that is not
+ * in the table.  The outcomes are set as for dist_table_compare, with the
+ * class as the first distribution.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls the index of a class in the table
+ * @param distribution an array of battlefields non-negative integers, non-NULL
+ * @param outcomes an array with room for battlefields values, non-NULL
+ */
+void dist_table_compare_to(const dist_table *t, size_t cls, const int *distribution, signed char *outcomes);
+
+
+/**
+ * Fills in what a side gets from each battlefield when it loses, ties or
+ * wins it, for dist_table_score_row.
+ *
+ * @param weights the weight of each battlefield, non-NULL
+ * @param battlefields the number of battlefields
+ * @param shares an array with room for 3 * battlefields values, non-NULL,
+ * set to 0, half the weight and the weight of each battlefield in turn
+ */
+void score_shares(const double *weights, int battlefields, double *shares);
+
+
+/**
+ * Scores a class against each of a run of classes, as dist_table_compare
+ * and score_matchup would score each pairing with the class first, and
+ * with the same results, but looking the score of each battlefield up
+ * instead of branching on its outcome.  When every battlefield has the same
+ * weight each pairing is scored by dist_table_score_uniform instead.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls the index of a class in the table
+ * @param others an array of the indices of n classes in the table, non-NULL
+ * @param n the number of classes to score against
+ * @param shares the shares of each battlefield set by score_shares, non-NULL
+ * @param outcomes an array with room for n outcomes, non-NULL
+ */
+void dist_table_score_row(const dist_table *t, size_t cls, const size_t *others, size_t n, const double *shares, pair_outcome *outcomes);
+
+
+/**
+ * Finds whether every battlefield has the same weight, and whether each
+ * score under the weights is then a count of half weights that a double
+ * holds exactly, so that dist_table_score_uniform can count battlefields
+ * instead of adding up their weights.
+ *
+ * @param weights the weight of each battlefield, non-NULL
+ * @param battlefields the number of battlefields, positive
+ * @param half a pointer to a double set to half the weight if the result is true, non-NULL
+ * @return true if matchups under the weights can be scored by
+ * dist_table_score_uniform, false otherwise
+ */
+bool uniform_weights(const double *weights, int battlefields, double *half);
+
+
+/**
+ * Scores a matchup between two classes when every battlefield has the same
+ * weight, as dist_table_compare and score_matchup would score it with the
+ * first class first, and with the same results.  The values of several
+ * battlefields are compared at once in a 64-bit word, giving a mask of the
+ * battlefields each side wins and ties, and the scores follow from the
+ * number of bits set in each mask.
+ *
+ * @param t a pointer to a table, non-NULL
+ * @param cls1 the index of a class in the table
+ * @param cls2 the index of a class in the table
+ * @param half half the weight of every battlefield, as set by uniform_weights
+ * @param outcome a pointer to the outcome to fill in, non-NULL
+ */
+void dist_table_score_uniform(const dist_table *t, size_t cls1, size_t cls2, double half, pair_outcome *outcome);
+
+
+/**
+ * Scores a matchup from its battlefield outcomes.  The first distribution
+ * gets the weight of each battlefield it wins, the second the weight of
+ * each battlefield it wins, and tied battlefields are split evenly.
+ *
+ * @param outcomes the outcomes set by dist_table_compare, non-NULL
+ * @param battlefields the number of battlefields
+ * @param weights the weight of each battlefield, non-NULL
+ * @param outcome a pointer to the outcome to fill in, non-NULL
+ */
+void score_matchup(const signed char *outcomes, int battlefields, const double *weights, pair_outcome *outcome);
+
+
+/**
+ * Returns the score a player facing itself gets from each side.  Both
+ * sides share one running score, and each battlefield is a tie, so half
+ * its weight is added to that score twice, battlefield by battlefield.
+ * Adding the halves in that order gives the same total as playing the
+ * matchup one battlefield at a time, which adding up the two sides'
+ * scores afterwards does not when the weights are not multiples of a
+ * power of two.
+ *
+ * @param weights the weight of each battlefield, non-NULL
+ * @param battlefields the number of battlefields
+ * @return the shared score
+ */
+double score_self_matchup(const double *weights, int battlefields);
+
+
+/**
+ * Scores a matchup from its battlefield outcomes under several weightings
+ * of the battlefields at once, as score_matchup would score it under each.
+ * The weights are stored battlefield by battlefield, so that the k weights
+ * of a battlefield are adjacent and each battlefield's outcome is applied
+ * to all the weightings in one pass.
+ *
+ * @param outcomes the outcomes set by dist_table_compare, non-NULL
+ * @param battlefields the number of battlefields
+ * @param weights an array of battlefields * k weights, the weight of
+ * battlefield b in weighting j at index b * k + j, non-NULL
+ * @param k the number of weightings, positive
+ * @param score1 an array with room for k scores of the first distribution, non-NULL
+ * @param score2 an array with room for k scores of the second distribution, non-NULL
+ * @param wins1 an array with room for k wins of the first distribution, non-NULL
+ */
+void score_matchup_weightings(const signed char *outcomes, int battlefields, const double *weights, size_t k,
+                              double *restrict score1, double *restrict score2, double *restrict wins1);
+
+
+/**
+ * Destroys the given table.  There is no effect if the given pointer is NULL.
+ *
+ * @param t a pointer to a table, or NULL
+ */
+void dist_table_destroy(dist_table *t);
+
+#endif
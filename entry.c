@@ -111,6 +111,98 @@ entry entry_read(FILE *in, int max_id, int battlefields)
   return result;
 }
 
+entry entry_parse(const char **pos, const char *end, int max_id, int battlefields)
+{
+  entry result;
+  const char *p = *pos;
+
+  result.distribution = malloc(sizeof(int) * battlefields);
+  result.id = malloc(sizeof(char) * (max_id + 1));
+
+  if (result.distribution == NULL || result.id == NULL)
+    {
+      // allocation error; abort
+      free(result.distribution);
+      result.distribution = NULL;
+      free(result.id);
+      result.id = NULL;
+      return result;
+    }
+
+  // same FSM as entry_read, with the end of the buffer in place of EOF
+  int ch = EOF;
+  parse_state state = ID;
+  int id_len = 0;
+  result.id[0] = '\0';
+  int curr_bf = 0;
+  int curr_int = 0;
+  while (p < end && (ch = (unsigned char) *p++) != '\n' && ch != '\r')
+    {
+      switch (state)
+        {
+        case ID:
+          if (ch == ',')
+            {
+              state = DISTRIBUTION;
+            }
+          else if (id_len < max_id)
+            {
+              result.id[id_len] = ch;
+              id_len++;
+              result.id[id_len] = '\0';
+            }
+          break;
+
+        case DISTRIBUTION:
+          if (ch == ',')
+            {
+              curr_bf++;
+              if (curr_bf >= battlefields)
+                {
+                  // too many battlefields
+                  entry_destroy(&result);
+                  *pos = p;
+                  return result;
+                }
+
+              curr_int = 0;
+            }
+          else if (!isdigit(ch))
+            {
+              entry_destroy(&result);
+              *pos = p;
+              return result;
+            }
+          else
+            {
+              curr_int = curr_int * 10 + (ch - '0');
+              result.distribution[curr_bf] = curr_int;
+            }
+          break;
+        }
+    }
+
+  // eat the character after a carriage-return, as entry_read does
+  if (ch == '\r' && p < end)
+    {
+      p++;
+    }
+  *pos = p;
+
+  if ((id_len == 0 && curr_bf > 0)
+      || (id_len > 0 && curr_bf != battlefields - 1))
+    {
+      entry_destroy(&result);
+    }
+  else if (id_len == 0)
+    {
+      free(result.distribution);
+      result.distribution = NULL;
+    }
+
+  return result;
+}
+
 void entry_destroy(entry *e)
 {
   if (e != NULL)
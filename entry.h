@@ -30,6 +30,20 @@ typedef struct entry
  */
 entry entry_read(FILE *in, int max_id, int battlefields);
 
+/**
+ * Parses a Blotto entry from memory, following the same rules as
+ * entry_read.  The line starts at *pos and ends at a newline, a
+ * carriage return (which consumes the character after it, as entry_read
+ * does), or at end, which plays the part of end-of-file.  On return *pos
+ * is just past the line.  The returned entry is as for entry_read.
+ *
+ * @param pos a pointer to the position of the line, non-NULL
+ * @param end the end of the input, not before *pos
+ * @param max_id, a positive integer
+ * @param battlefields a positive integer
+ */
+entry entry_parse(const char **pos, const char *end, int max_id, int battlefields);
+
 /**
  * Frees the id and distribution in the given entry.
  *
@@ -0,0 +1,302 @@
+#include "estimate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+//opponents scored together for a class
+#define ESTIMATE_BATCH 256
+
+//the standard normal quantile of a two-sided 95% interval
+#define ESTIMATE_Z 1.959963984540054
+
+/**
+ * The sampling of one class so far
+ *
+ * @param cls the index of the class
+ * @param state the state of the class's xorshift64* generator
+ * @param need the number of opponents to draw in this round
+ * @param wins the wins so far
+ * @param wins_squared the sum of the square of each game's wins
+ * @param score the total score so far
+ * @param score_squared the sum of the square of each game's score
+ * @param games the number of opponents drawn so far
+ * @param wins_margin the half-width of the interval of the win rate
+ * @param score_margin the half-width of the interval of the average score
+ */
+typedef struct _estimate_class
+{
+    size_t cls;
+    uint64_t state;
+    size_t need;
+    double wins;
+    double wins_squared;
+    double score;
+    double score_squared;
+    double games;
+    double wins_margin;
+    double score_margin;
+} estimate_class;
+
+/**
+ * The classes sampled by one thread in a round
+ *
+ * @param classes the players' distributions
+ * @param shares the shares of each battlefield, as score_shares sets them
+ * @param player_classes the class of each player, which opponents are drawn from
+ * @param n the number of players
+ * @param todo the classes to sample this round
+ * @param first the index in todo of the first class of this thread
+ * @param last one past the index in todo of the last class of this thread
+ */
+typedef struct _estimate_task
+{
+    const dist_table *classes;
+    const double *shares;
+    const size_t *player_classes;
+    size_t n;
+    estimate_class **todo;
+    size_t first;
+    size_t last;
+} estimate_task;
+
+/**
+ * A class's place in the ranking that decides which classes are sampled more
+ *
+ * @param value the win rate or average score
+ * @param margin the half-width of the interval of the value
+ * @param index the index of the class among those sampled
+ */
+typedef struct _estimate_rank
+{
+    double value;
+    double margin;
+    size_t index;
+} estimate_rank;
+
+void *estimate_run_task(void *arg);
+bool estimate_round(estimate_task *tasks, pthread_t *ids, int threads, size_t count);
+double estimate_margin(double sum, double sum_squared, double games, double best);
+uint64_t estimate_random(uint64_t *state);
+int estimate_compare_rank(const void *key1, const void *key2);
+
+bool estimate_field(const dist_table *classes, const double *weights, const size_t *player_classes, size_t n,
+                    const estimate_plan *plan, int threads, estimate_result *results)
+{
+    int battlefields = dist_table_battlefields(classes);
+    size_t num_classes = dist_table_size(classes);
+    bool *used = calloc(num_classes > 0 ? num_classes : 1, sizeof(bool));
+    estimate_class *sampled = malloc(sizeof(estimate_class) * (num_classes > 0 ? num_classes : 1));
+    estimate_class **todo = malloc(sizeof(estimate_class*) * (num_classes > 0 ? num_classes : 1));
+    estimate_rank *ranks = malloc(sizeof(estimate_rank) * (num_classes > 0 ? num_classes : 1));
+    double *shares = malloc(sizeof(double) * 3 * battlefields);
+    estimate_task *tasks = malloc(sizeof(estimate_task) * threads);
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    bool ok = (used != NULL && sampled != NULL && todo != NULL && ranks != NULL && shares != NULL && tasks != NULL && ids != NULL);
+
+    //only classes that players have are sampled, each with a generator of its own
+    size_t count = 0;
+    double total = 0.0;
+    for (size_t i = 0; ok && i < n; i++)
+    {
+        if (!used[player_classes[i]])
+        {
+            used[player_classes[i]] = true;
+            estimate_class *c = &sampled[count++];
+            memset(c, 0, sizeof(estimate_class));
+            c->cls = player_classes[i];
+            c->state = (plan->seed * 0x9E3779B97F4A7C15ULL + 1) ^ ((c->cls + 1) * 0xBF58476D1CE4E5B9ULL);
+            c->state = (c->state != 0 ? c->state : 1);
+            c->need = plan->initial;
+        }
+    }
+    for (int i = 0; ok && i < battlefields; i++)
+    {
+        total += weights[i];
+    }
+    if (ok)
+    {
+        score_shares(weights, battlefields, shares);
+    }
+    for (int t = 0; ok && t < threads; t++)
+    {
+        tasks[t].classes = classes;
+        tasks[t].shares = shares;
+        tasks[t].player_classes = player_classes;
+        tasks[t].n = n;
+        tasks[t].todo = todo;
+    }
+
+    size_t pending = count;
+    while (ok && pending > 0)
+    {
+        size_t listed = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (sampled[i].need > 0)
+            {
+                todo[listed++] = &sampled[i];
+            }
+        }
+        ok = estimate_round(tasks, ids, threads, listed);
+
+        //rank the classes as they stand, each with its interval
+        for (size_t i = 0; ok && i < count; i++)
+        {
+            estimate_class *c = &sampled[i];
+            c->wins_margin = estimate_margin(c->wins, c->wins_squared, c->games, 1.0);
+            c->score_margin = estimate_margin(c->score, c->score_squared, c->games, total);
+            ranks[i].value = (plan->by_score ? c->score : c->wins) / c->games;
+            ranks[i].margin = (plan->by_score ? c->score_margin : c->wins_margin);
+            ranks[i].index = i;
+        }
+        if (ok)
+        {
+            qsort(ranks, count, sizeof(estimate_rank), estimate_compare_rank);
+        }
+
+        //a class whose place is uncertain next to either neighbour is sampled twice as much
+        pending = 0;
+        for (size_t p = 0; ok && p < count; p++)
+        {
+            estimate_class *c = &sampled[ranks[p].index];
+            bool above = (p > 0 && ranks[p - 1].value - ranks[p].value < ranks[p - 1].margin + ranks[p].margin);
+            bool below = (p + 1 < count && ranks[p].value - ranks[p + 1].value < ranks[p].margin + ranks[p + 1].margin);
+            if ((above || below) && ranks[p].margin > plan->precision && c->games < plan->limit)
+            {
+                size_t games = c->games;
+                c->need = (plan->limit - games < games ? plan->limit - games : games);
+                pending++;
+            }
+        }
+    }
+
+    for (size_t i = 0; ok && i < count; i++)
+    {
+        estimate_result *r = &results[sampled[i].cls];
+        r->wins = sampled[i].wins;
+        r->overall_score = sampled[i].score;
+        r->games = sampled[i].games;
+        r->wins_margin = sampled[i].wins_margin;
+        r->score_margin = sampled[i].score_margin;
+    }
+
+    free(used);
+    free(sampled);
+    free(todo);
+    free(ranks);
+    free(shares);
+    free(tasks);
+    free(ids);
+
+    return ok;
+}
+
+//samples the first count classes in the tasks' todo list on the given number of threads, each taking a contiguous share
+bool estimate_round(estimate_task *tasks, pthread_t *ids, int threads, size_t count)
+{
+    int started = 0;
+    bool ok = true;
+    for (int t = 0; t < threads; t++)
+    {
+        tasks[t].first = count * t / threads;
+        tasks[t].last = count * (t + 1) / threads;
+        if (pthread_create(&ids[t], NULL, estimate_run_task, &tasks[t]) != 0)
+        {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+
+    //a thread returns non-NULL if it could not allocate its buffers
+    for (int t = 0; t < started; t++)
+    {
+        void *status;
+        pthread_join(ids[t], &status);
+        if (status != NULL)
+        {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+void *estimate_run_task(void *arg)
+{
+    estimate_task *task = arg;
+    size_t *others = malloc(sizeof(size_t) * ESTIMATE_BATCH);
+    pair_outcome *outcomes = malloc(sizeof(pair_outcome) * ESTIMATE_BATCH);
+    if (others == NULL || outcomes == NULL)
+    {
+        free(others);
+        free(outcomes);
+        return task;
+    }
+
+    for (size_t i = task->first; i < task->last; i++)
+    {
+        estimate_class *c = task->todo[i];
+        while (c->need > 0)
+        {
+            //a batch of opponents drawn from the players, so each class is drawn as often as it has players
+            size_t batch = (c->need < ESTIMATE_BATCH ? c->need : ESTIMATE_BATCH);
+            for (size_t k = 0; k < batch; k++)
+            {
+                others[k] = task->player_classes[estimate_random(&c->state) % task->n];
+            }
+            dist_table_score_row(task->classes, c->cls, others, batch, task->shares, outcomes);
+
+            for (size_t k = 0; k < batch; k++)
+            {
+                c->wins += outcomes[k].wins1;
+                c->wins_squared += outcomes[k].wins1 * outcomes[k].wins1;
+                c->score += outcomes[k].score1;
+                c->score_squared += outcomes[k].score1 * outcomes[k].score1;
+            }
+            c->games += batch;
+            c->need -= batch;
+        }
+    }
+
+    free(others);
+    free(outcomes);
+    return NULL;
+}
+
+double estimate_margin(double sum, double sum_squared, double games, double best)
+{
+    //one game at the best and one at the worst are added to the spread, but not to the mean
+    double n = games + 2;
+    double s = sum + best;
+    double variance = (sum_squared + best * best - s * s / n) / (n - 1);
+    return ESTIMATE_Z * sqrt((variance > 0 ? variance : 0) / games);
+}
+
+//function for the next number of the xorshift64* generator, as gen_tournament uses
+uint64_t estimate_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+int estimate_compare_rank(const void *key1, const void *key2)
+{
+    //highest first, then by index so the ranking does not depend on qsort
+    const estimate_rank *r1 = key1;
+    const estimate_rank *r2 = key2;
+
+    if (r1->value != r2->value)
+    {
+        return (r1->value > r2->value ? -1 : 1);
+    }
+
+    return (r1->index < r2->index ? -1 : (r1->index > r2->index));
+}
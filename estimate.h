@@ -0,0 +1,78 @@
+#ifndef __ESTIMATE_H__
+#define __ESTIMATE_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "distribution.h"
+
+/**
+ * How to sample the field
+ *
+ * @param initial the number of opponents first drawn for each class, positive
+ * @param limit the most opponents drawn for a class, at least initial
+ * @param precision the half-width of interval to stop at, in win rate when
+ * ranking by wins and in average score when ranking by score
+ * @param by_score true to refine the ranking by average score, false by win rate
+ * @param seed the seed for drawing opponents
+ */
+typedef struct _estimate_plan
+{
+    size_t initial;
+    size_t limit;
+    double precision;
+    bool by_score;
+    uint64_t seed;
+} estimate_plan;
+
+/**
+ * What sampling found for one class
+ *
+ * @param wins the wins against the opponents drawn, ties count as half a win
+ * @param overall_score the total score against the opponents drawn
+ * @param games the number of opponents drawn
+ * @param wins_margin half the width of the 95% confidence interval of the win rate
+ * @param score_margin half the width of the 95% confidence interval of the average score
+ */
+typedef struct _estimate_result
+{
+    double wins;
+    double overall_score;
+    double games;
+    double wins_margin;
+    double score_margin;
+} estimate_result;
+
+/**
+ * Estimates how each class of the given players fares against the whole
+ * field of players by playing it against opponents drawn at random from
+ * the field, with replacement, so that each class is drawn as often as it
+ * has players.  Every class is first given the initial number of
+ * opponents.  Then, round after round, the classes are ranked and each one
+ * whose interval overlaps that of a class next to it in the ranking, and
+ * is still wider than the precision asked for, has its number of opponents
+ * doubled, up to the limit; classes that are clearly apart from their
+ * neighbours are left as they are.  Each class draws its opponents from a
+ * generator of its own seeded from the plan's seed and its index, so the
+ * results do not depend on the number of threads.
+ *
+ * The intervals are normal approximations, with one extra best and one
+ * extra worst game counted towards the spread, so that a class that wins
+ * every game drawn still has an interval.
+ *
+ * @param classes a pointer to the table of the players' distributions, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param player_classes the index of the class of each player, non-NULL
+ * @param n the number of players, positive
+ * @param plan a pointer to how to sample, non-NULL
+ * @param threads the number of threads to use, positive
+ * @param results an array with room for a result for each class of the
+ * table, non-NULL; the results of classes with no players are left as they are
+ * @return true if the classes were estimated, false if there was an
+ * allocation or thread creation error
+ */
+bool estimate_field(const dist_table *classes, const double *weights, const size_t *player_classes, size_t n,
+                    const estimate_plan *plan, int threads, estimate_result *results);
+
+#endif
@@ -0,0 +1,323 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Generates a synthetic tournament: a distribution file in the format
+ * blotto reads from standard input and a matchup file of id pairs.
+ *
+ * usage: gen_tournament [options] prefix
+ *
+ * writes prefix.dist and prefix.match, with options
+ *   -p players       number of players (default 1000)
+ *   -b battlefields  number of battlefields (default 10)
+ *   -u units         units each player spreads over the battlefields (default 100)
+ *   -m matchups      number of matchup lines (default 10000)
+ *   -i min,max       range of id lengths (default 4,12, at most 31)
+ *   -d rate          fraction of players copying an earlier distribution (default 0)
+ *   -r rate          fraction of matchups repeating an earlier pair (default 0)
+ *   -s seed          seed for the random generator (default 1)
+ */
+
+//longest id blotto reads from a matchup file without overflowing its buffer
+#define GEN_MAX_ID 31
+
+//number of recent pairs a repeated pair is drawn from
+#define GEN_RECENT_PAIRS 4096
+
+/**
+ * Settings of one run of the generator
+ */
+typedef struct _gen_options
+{
+    size_t players;
+    int battlefields;
+    int units;
+    size_t matchups;
+    int id_min;
+    int id_max;
+    double dup_rate;
+    double repeat_rate;
+    uint64_t seed;
+    const char *prefix;
+} gen_options;
+
+//state of the xorshift64* generator
+static uint64_t gen_state;
+
+uint64_t gen_next(void);
+double gen_uniform(void);
+size_t gen_below(size_t n);
+int gen_parse(int argc, char *argv[], gen_options *opts);
+void gen_make_id(char *id, size_t index, int id_min, int id_max);
+void gen_make_distribution(int *distribution, int battlefields, int units);
+int gen_compare_ints(const void *a, const void *b);
+bool gen_write_distributions(const gen_options *opts, char *ids);
+bool gen_write_matchups(const gen_options *opts, const char *ids);
+
+int main(int argc, char *argv[])
+{
+    gen_options opts;
+    if (gen_parse(argc, argv, &opts) != 0)
+    {
+        fprintf(stderr, "usage: gen_tournament [-p players] [-b battlefields] [-u units] [-m matchups]"
+                " [-i min,max] [-d rate] [-r rate] [-s seed] prefix\n");
+        return 1;
+    }
+
+    gen_state = opts.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    //ids are kept in fixed slots so matchups can refer to any player
+    char *ids = malloc((GEN_MAX_ID + 1) * opts.players);
+    if (ids == NULL)
+    {
+        fprintf(stderr, "gen_tournament: could not allocate ids\n");
+        return 1;
+    }
+
+    bool ok = gen_write_distributions(&opts, ids) && gen_write_matchups(&opts, ids);
+    free(ids);
+
+    return (ok ? 0 : 1);
+}
+
+uint64_t gen_next(void)
+{
+    gen_state ^= gen_state >> 12;
+    gen_state ^= gen_state << 25;
+    gen_state ^= gen_state >> 27;
+    return gen_state * 0x2545F4914F6CDD1DULL;
+}
+
+double gen_uniform(void)
+{
+    return (gen_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t gen_below(size_t n)
+{
+    return gen_next() % n;
+}
+
+int gen_parse(int argc, char *argv[], gen_options *opts)
+{
+    opts->players = 1000;
+    opts->battlefields = 10;
+    opts->units = 100;
+    opts->matchups = 10000;
+    opts->id_min = 4;
+    opts->id_max = 12;
+    opts->dup_rate = 0.0;
+    opts->repeat_rate = 0.0;
+    opts->seed = 1;
+    opts->prefix = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            opts->prefix = argv[i];
+            continue;
+        }
+
+        if (i + 1 == argc || strlen(argv[i]) != 2)
+        {
+            return 1;
+        }
+
+        char *value = argv[++i];
+        switch (argv[i - 1][1])
+        {
+        case 'p':
+            opts->players = strtoull(value, NULL, 10);
+            break;
+        case 'b':
+            opts->battlefields = atoi(value);
+            break;
+        case 'u':
+            opts->units = atoi(value);
+            break;
+        case 'm':
+            opts->matchups = strtoull(value, NULL, 10);
+            break;
+        case 'i':
+            if (sscanf(value, "%d,%d", &opts->id_min, &opts->id_max) != 2)
+            {
+                return 1;
+            }
+            break;
+        case 'd':
+            opts->dup_rate = atof(value);
+            break;
+        case 'r':
+            opts->repeat_rate = atof(value);
+            break;
+        case 's':
+            opts->seed = strtoull(value, NULL, 10);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (opts->prefix == NULL || opts->players < 2 || opts->battlefields <= 0 || opts->units < 0
+        || opts->id_min < 1 || opts->id_max > GEN_MAX_ID || opts->id_min > opts->id_max)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+//function for making a unique id: the index in base 36 padded with random letters
+void gen_make_id(char *id, size_t index, int id_min, int id_max)
+{
+    char digits[GEN_MAX_ID + 1];
+    int n = 0;
+    do
+    {
+        digits[n++] = "0123456789abcdefghijklmnopqrstuvwxyz"[index % 36];
+        index /= 36;
+    } while (index > 0);
+
+    int len = id_min + gen_below(id_max - id_min + 1);
+    if (len < n + 1)
+    {
+        len = n + 1;
+    }
+
+    //a letter prefix that ends in an underscore keeps ids of different lengths distinct
+    int pad = len - n - 1;
+    for (int i = 0; i < pad; i++)
+    {
+        id[i] = 'A' + gen_below(26);
+    }
+    id[pad] = '_';
+
+    for (int i = 0; i < n; i++)
+    {
+        id[pad + 1 + i] = digits[n - 1 - i];
+    }
+    id[len] = '\0';
+}
+
+int gen_compare_ints(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+//function for spreading units over battlefields uniformly at random (stars and bars)
+void gen_make_distribution(int *distribution, int battlefields, int units)
+{
+    for (int i = 0; i < battlefields - 1; i++)
+    {
+        distribution[i] = gen_below(units + 1);
+    }
+    qsort(distribution, battlefields - 1, sizeof(int), gen_compare_ints);
+
+    int prev = 0;
+    for (int i = 0; i < battlefields - 1; i++)
+    {
+        int cut = distribution[i];
+        distribution[i] = cut - prev;
+        prev = cut;
+    }
+    distribution[battlefields - 1] = units - prev;
+}
+
+bool gen_write_distributions(const gen_options *opts, char *ids)
+{
+    char name[4096];
+    snprintf(name, sizeof(name), "%s.dist", opts->prefix);
+    FILE *out = fopen(name, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "gen_tournament: could not open %s\n", name);
+        return false;
+    }
+
+    //every distribution is remembered so duplicates can copy an earlier one
+    int *distributions = malloc(sizeof(int) * opts->battlefields * opts->players);
+    if (distributions == NULL)
+    {
+        fclose(out);
+        fprintf(stderr, "gen_tournament: could not allocate distributions\n");
+        return false;
+    }
+
+    for (size_t p = 0; p < opts->players; p++)
+    {
+        char *id = ids + p * (GEN_MAX_ID + 1);
+        int *distribution = distributions + p * opts->battlefields;
+
+        gen_make_id(id, p, opts->id_min, opts->id_max);
+        if (p > 0 && gen_uniform() < opts->dup_rate)
+        {
+            memcpy(distribution, distributions + gen_below(p) * opts->battlefields, sizeof(int) * opts->battlefields);
+        }
+        else
+        {
+            gen_make_distribution(distribution, opts->battlefields, opts->units);
+        }
+
+        fputs(id, out);
+        for (int i = 0; i < opts->battlefields; i++)
+        {
+            fprintf(out, ",%d", distribution[i]);
+        }
+        fputc('\n', out);
+    }
+
+    free(distributions);
+    return fclose(out) == 0;
+}
+
+bool gen_write_matchups(const gen_options *opts, const char *ids)
+{
+    char name[4096];
+    snprintf(name, sizeof(name), "%s.match", opts->prefix);
+    FILE *out = fopen(name, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "gen_tournament: could not open %s\n", name);
+        return false;
+    }
+
+    //ring of recent pairs that repeated matchups are drawn from
+    size_t recent[GEN_RECENT_PAIRS][2];
+    size_t num_recent = 0;
+
+    for (size_t m = 0; m < opts->matchups; m++)
+    {
+        size_t p1, p2;
+        if (num_recent > 0 && gen_uniform() < opts->repeat_rate)
+        {
+            size_t r = gen_below(num_recent < GEN_RECENT_PAIRS ? num_recent : GEN_RECENT_PAIRS);
+            p1 = recent[r][0];
+            p2 = recent[r][1];
+        }
+        else
+        {
+            p1 = gen_below(opts->players);
+            p2 = gen_below(opts->players - 1);
+            if (p2 >= p1)
+            {
+                p2++;
+            }
+            recent[num_recent % GEN_RECENT_PAIRS][0] = p1;
+            recent[num_recent % GEN_RECENT_PAIRS][1] = p2;
+            num_recent++;
+        }
+
+        fputs(ids + p1 * (GEN_MAX_ID + 1), out);
+        fputc(' ', out);
+        fputs(ids + p2 * (GEN_MAX_ID + 1), out);
+        fputc('\n', out);
+    }
+
+    return fclose(out) == 0;
+}
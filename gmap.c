@@ -4,10 +4,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 char *gmap_error = "error";
 
-//(key, value) pair stored in struct
+//(key, value) pair stored in struct; a map with inline values keeps the value after the entry
 typedef struct _entry
 {
     void *key;
@@ -15,6 +16,18 @@ typedef struct _entry
     struct _entry *next;
 } entry;
 
+//the widest basic types, whose size is a multiple of the strictest alignment malloc gives
+typedef union _gmap_max_align
+{
+    long double ld;
+    long long ll;
+    void *p;
+    void (*fp)(void);
+} gmap_max_align;
+
+//where an inline value starts, the entry rounded up so the value is aligned as a malloc block is
+#define GMAP_VALUE_OFFSET (((sizeof(entry) + sizeof(gmap_max_align) - 1) / sizeof(gmap_max_align)) * sizeof(gmap_max_align))
+
 
 /**
  * Returns the index where key is located in the given map, or the index
@@ -23,28 +36,43 @@ typedef struct _entry
  * @param table a table with at least one free slot, non-NULL
  * @param size the size of the table
  * @param capacity the capacity of the table
+ * @param rehashes the number of times the table has grown
+ * @param rehash_clock the processor time spent growing the table
+ * @param lookups, probes, max_probes, probe_counts per-operation probe counts (GMAP_DEBUG only)
  * @param key a string, non-NULL
  * @param hash the hash function used for the keys, non-NULL
  * @param compare a comparison function for keys, non-NULL
  * @param copy a function for copying keys, non-NULL
  * @param free a function for freeing keys, non-NULL
+ * @param value_size the number of bytes of each value stored in the map, or 0 if the map stores pointers
  */
 struct _gmap
 {
     entry **table;
     size_t capacity;
     size_t size;
+    size_t rehashes;
+    clock_t rehash_clock;
+#ifdef GMAP_DEBUG
+    size_t lookups;
+    size_t probes;
+    size_t max_probes;
+    size_t probe_counts[GMAP_HISTOGRAM_BUCKETS];
+#endif
     size_t (*hash)(const void *);
     int (*compare)(const void *, const void *);
     void *(*copy)(const void *);
     void (*free)(void *);
+    size_t value_size;
 };
 
 size_t gmap_compute_index(const void *key, size_t (*hash)(const void*), size_t capacity);
-entry *gmap_table_find_key(entry **table, const void *key, size_t (*hash)(const void *), int (*compare)(const void *, const void *), size_t capacity);
+entry *gmap_table_find_key(entry **table, const void *key, size_t (*hash)(const void *), int (*compare)(const void *, const void *), size_t capacity, size_t *probes);
 void gmap_embiggen(gmap *m, size_t n);
 void gmap_table_add(entry **table, entry *n, size_t (*hash)(const void* ), size_t capacity);
 void gmap_store_key_in_array(const void *key, void *value, void *arg);
+void gmap_count_probes(const gmap *m, size_t probes);
+entry *gmap_add_entry(gmap *m, const void *key);
 
 //initial capcity of table
 #define GMAP_INITIAL_CAPACITY 100
@@ -66,11 +94,23 @@ gmap *gmap_create(void *(*cp)(const void *), int (*comp)(const void *, const voi
         result->compare = comp;
         result->hash = h;
         result->free = f;
+        result->value_size = 0;
 
         //initialize the table
         result->table = malloc(GMAP_INITIAL_CAPACITY * sizeof(entry*));
         result->capacity = (result->table != NULL ? GMAP_INITIAL_CAPACITY : 0);
         result->size = 0;
+        result->rehashes = 0;
+        result->rehash_clock = 0;
+#ifdef GMAP_DEBUG
+        result->lookups = 0;
+        result->probes = 0;
+        result->max_probes = 0;
+        for (size_t i = 0; i < GMAP_HISTOGRAM_BUCKETS; i++)
+        {
+            result->probe_counts[i] = 0;
+        }
+#endif
 
         //each element in table should be NULL when initialized
         for (size_t i = 0; i < result->capacity; i++)
@@ -82,6 +122,22 @@ gmap *gmap_create(void *(*cp)(const void *), int (*comp)(const void *, const voi
     return result;
 }
 
+gmap *gmap_create_inline(void *(*cp)(const void *), int (*comp)(const void *, const void *), size_t (*h)(const void *s), void (*f)(void *), size_t value_size)
+{
+    if (value_size == 0)
+    {
+        return NULL;
+    }
+
+    gmap *result = gmap_create(cp, comp, h, f);
+    if (result != NULL)
+    {
+        result->value_size = value_size;
+    }
+
+    return result;
+}
+
 size_t gmap_size(const gmap *m)
 {
     if (m == NULL)
@@ -92,6 +148,82 @@ size_t gmap_size(const gmap *m)
     return m->size;
 }
 
+size_t gmap_rehashes(const gmap *m)
+{
+    if (m == NULL)
+    {
+        return 0;
+    }
+
+    return m->rehashes;
+}
+
+void gmap_stats(const gmap *m, gmap_statistics *stats)
+{
+    stats->size = m->size;
+    stats->capacity = m->capacity;
+    stats->load_factor = (m->capacity > 0 ? (double) m->size / m->capacity : 0.0);
+    stats->max_chain = 0;
+    stats->rehashes = m->rehashes;
+    stats->rehash_seconds = (double) m->rehash_clock / CLOCKS_PER_SEC;
+    stats->bytes = sizeof(gmap) + m->capacity * sizeof(entry*) + m->size * (m->value_size > 0 ? GMAP_VALUE_OFFSET + m->value_size : sizeof(entry));
+
+    for (size_t i = 0; i < GMAP_HISTOGRAM_BUCKETS; i++)
+    {
+        stats->chain_lengths[i] = 0;
+    }
+
+    //walk each chain to find its length
+    for (size_t chain = 0; chain < m->capacity; chain++)
+    {
+        size_t length = 0;
+        for (entry *curr = m->table[chain]; curr != NULL; curr = curr->next)
+        {
+            length++;
+        }
+
+        stats->chain_lengths[length < GMAP_HISTOGRAM_BUCKETS ? length : GMAP_HISTOGRAM_BUCKETS - 1]++;
+        if (length > stats->max_chain)
+        {
+            stats->max_chain = length;
+        }
+    }
+
+#ifdef GMAP_DEBUG
+    stats->lookups = m->lookups;
+    stats->probes = m->probes;
+    stats->max_probes = m->max_probes;
+    for (size_t i = 0; i < GMAP_HISTOGRAM_BUCKETS; i++)
+    {
+        stats->probe_counts[i] = m->probe_counts[i];
+    }
+#else
+    stats->lookups = 0;
+    stats->probes = 0;
+    stats->max_probes = 0;
+    for (size_t i = 0; i < GMAP_HISTOGRAM_BUCKETS; i++)
+    {
+        stats->probe_counts[i] = 0;
+    }
+#endif
+}
+
+//function for recording the keys compared by one search; does nothing without GMAP_DEBUG
+void gmap_count_probes(const gmap *m, size_t probes)
+{
+#ifdef GMAP_DEBUG
+    //the counts are bookkeeping, not part of the map's value, so searches through a const map record them too
+    gmap *counted = (gmap *) m;
+    counted->lookups++;
+    counted->probes += probes;
+    counted->probe_counts[probes < GMAP_HISTOGRAM_BUCKETS ? probes : GMAP_HISTOGRAM_BUCKETS - 1]++;
+    if (probes > counted->max_probes)
+    {
+        counted->max_probes = probes;
+    }
+#endif
+}
+
 //function to find index of specific key
 size_t gmap_compute_index(const void *key, size_t (*hash)(const void*), size_t capacity)
 {
@@ -100,14 +232,15 @@ size_t gmap_compute_index(const void *key, size_t (*hash)(const void*), size_t c
 
 
 //function for sequential search
-entry *gmap_table_find_key(entry **table, const void *key, size_t (*hash)(const void *), int (*compare)(const void *, const void *), size_t capacity)
+entry *gmap_table_find_key(entry **table, const void *key, size_t (*hash)(const void *), int (*compare)(const void *, const void *), size_t capacity, size_t *probes)
 {
     //determine which chain to search from
     size_t ind = gmap_compute_index(key, hash, capacity);
 
     //sequential search
     entry *curr = table[ind];
-    while (curr != NULL && compare(curr->key, key) != 0)
+    *probes = 0;
+    while (curr != NULL && ((*probes)++, compare(curr->key, key) != 0))
     {
         curr = curr->next;
     }
@@ -118,6 +251,7 @@ entry *gmap_table_find_key(entry **table, const void *key, size_t (*hash)(const
 //function for increasing the chains and rehashing keys
 void gmap_embiggen(gmap *m, size_t n)
 {
+    clock_t start = clock();
     entry **new_table = malloc(n * sizeof(entry*));
 
     //each element in table should be NULL when initialized
@@ -138,9 +272,11 @@ void gmap_embiggen(gmap *m, size_t n)
     }
 
     m->capacity = n;
+    m->rehashes++;
     free(m->table);
 
     m->table = new_table;
+    m->rehash_clock += clock() - start;
 }
 
 void gmap_table_add(entry **table, entry *n, size_t (*hash)(const void* ), size_t capacity)
@@ -160,8 +296,16 @@ void *gmap_put(gmap *m, const void *key, void *value)
         return false;
     }
 
-    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity);
-    if (n != NULL)
+    size_t probes;
+    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity, &probes);
+    gmap_count_probes(m, probes);
+    if (n != NULL && m->value_size > 0)
+    {
+        //key already present, the value is copied over the one in the map
+        memcpy(n->value, value, m->value_size);
+        return NULL;
+    }
+    else if (n != NULL)
     {
         //key already present
         void *old_value = n->value;
@@ -170,39 +314,74 @@ void *gmap_put(gmap *m, const void *key, void *value)
     }
     else
     {
-        //make a copy og key
-        void *copy = m->copy(key);
+        n = gmap_add_entry(m, key);
+        if (n == NULL)
+        {
+            return gmap_error;
+        }
 
-        if (copy != NULL)
+        if (m->value_size > 0)
         {
-            //check if load factor is too high
-            if (m->size >= m->capacity)
-            {
-                //add chains and rehash
-                gmap_embiggen(m, m->capacity*2);
-            }
-
-            //add to table
-            entry *n = malloc(sizeof(entry));
-            if (n != NULL)
-            {
-                n->key = copy;
-                n->value = value;
-                gmap_table_add(m->table, n, m->hash, m->capacity);
-                m->size++;
-                return NULL;
-            }
-            else
-            {
-                m->free(copy);
-                return gmap_error;
-            }
+            memcpy(n->value, value, m->value_size);
         }
         else
         {
-            return gmap_error;
+            n->value = value;
+        }
+        return NULL;
+    }
+}
+
+void *gmap_upsert(gmap *m, const void *key, bool *added)
+{
+    size_t probes;
+    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity, &probes);
+    gmap_count_probes(m, probes);
+    *added = (n == NULL);
+    if (n == NULL)
+    {
+        //new values start zeroed
+        n = gmap_add_entry(m, key);
+        if (n == NULL)
+        {
+            return NULL;
         }
+        memset(n->value, 0, m->value_size);
+    }
+
+    return n->value;
+}
+
+//function for adding an entry for a key known not to be present; the value is left to the caller
+entry *gmap_add_entry(gmap *m, const void *key)
+{
+    //make a copy og key
+    void *copy = m->copy(key);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
+    //check if load factor is too high
+    if (m->size >= m->capacity)
+    {
+        //add chains and rehash
+        gmap_embiggen(m, m->capacity*2);
     }
+
+    //add to table, with room for an inline value after the entry
+    entry *n = malloc(m->value_size > 0 ? GMAP_VALUE_OFFSET + m->value_size : sizeof(entry));
+    if (n == NULL)
+    {
+        m->free(copy);
+        return NULL;
+    }
+
+    n->key = copy;
+    n->value = (m->value_size > 0 ? (void *) ((char *) n + GMAP_VALUE_OFFSET) : NULL);
+    gmap_table_add(m->table, n, m->hash, m->capacity);
+    m->size++;
+    return n;
 }
 
 void *gmap_remove(gmap *m, const void *key)
@@ -219,11 +398,13 @@ void *gmap_remove(gmap *m, const void *key)
     //sequential search
     entry *curr = m->table[ind];
     entry *prev = NULL;
-    while (curr != NULL && m->compare(curr->key, key) != 0)
+    size_t probes = 0;
+    while (curr != NULL && (probes++, m->compare(curr->key, key) != 0))
     {
         prev = curr;
         curr = curr->next;
     }
+    gmap_count_probes(m, probes);
     if (curr == NULL)
     {
         return NULL;
@@ -234,7 +415,7 @@ void *gmap_remove(gmap *m, const void *key)
     {
         entry *temp = curr;
         m->table[ind] = curr->next;
-        val = temp->value;
+        val = (m->value_size > 0 ? NULL : temp->value);
         m->free(temp->key);
         free(temp);
 
@@ -245,7 +426,7 @@ void *gmap_remove(gmap *m, const void *key)
     else
     {
         prev->next = curr->next;
-        val = curr->value;
+        val = (m->value_size > 0 ? NULL : curr->value);
 
         m->free(curr->key); 
         free(curr);
@@ -260,7 +441,10 @@ void *gmap_remove(gmap *m, const void *key)
 
 bool gmap_contains_key(const gmap *m, const void *key)
 {
-    if (gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity) == NULL)
+    size_t probes;
+    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity, &probes);
+    gmap_count_probes(m, probes);
+    if (n == NULL)
     {
         return false;
     }
@@ -275,7 +459,9 @@ void *gmap_get(gmap *m, const void *key)
         return NULL;
     }
 
-    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity);
+    size_t probes;
+    entry *n = gmap_table_find_key(m->table, key, m->hash, m->compare, m->capacity, &probes);
+    gmap_count_probes(m, probes);
     if (n != NULL)
     {
         //return the value in that node
@@ -363,4 +549,5 @@ void gmap_destroy(gmap *m)
         }
     }  
     free(m->table);
-    free(m);
\ No newline at end of file
+    free(m);
+}
\ No newline at end of file
@@ -12,6 +12,48 @@ typedef struct _gmap gmap;
  */
 extern char *gmap_error;
 
+/**
+ * Number of buckets in the histograms of gmap_statistics.  The last
+ * bucket counts everything at least that long.
+ */
+#define GMAP_HISTOGRAM_BUCKETS 8
+
+/**
+ * A snapshot of the shape and history of a map, filled in by gmap_stats.
+ * The probe counts are only kept when gmap.c is compiled with GMAP_DEBUG
+ * defined and are zero otherwise.  Keeping them makes every search write
+ * to the map, so a map kept this way cannot be searched by several threads
+ * at once.
+ *
+ * @param size the number of (key, value) pairs
+ * @param capacity the number of chains
+ * @param load_factor size divided by capacity
+ * @param chain_lengths the number of chains of each length
+ * @param max_chain the length of the longest chain
+ * @param rehashes the number of times the table has grown
+ * @param rehash_seconds the processor time spent growing the table
+ * @param bytes the memory used by the map itself, not counting keys or values
+ * @param lookups the number of operations that searched for a key
+ * @param probes the total number of keys compared by those operations
+ * @param max_probes the most keys compared by one operation
+ * @param probe_counts the number of operations that compared each number of keys
+ */
+typedef struct _gmap_statistics
+{
+    size_t size;
+    size_t capacity;
+    double load_factor;
+    size_t chain_lengths[GMAP_HISTOGRAM_BUCKETS];
+    size_t max_chain;
+    size_t rehashes;
+    double rehash_seconds;
+    size_t bytes;
+    size_t lookups;
+    size_t probes;
+    size_t max_probes;
+    size_t probe_counts[GMAP_HISTOGRAM_BUCKETS];
+} gmap_statistics;
+
 /**
  * Creates an empty map that uses the given hash function.
  *
@@ -26,6 +68,28 @@ extern char *gmap_error;
 gmap *gmap_create(void *(*cp)(const void *), int (*comp)(const void *, const void *), size_t (*h)(const void *s), void (*f)(void *));
 
 
+/**
+ * Creates an empty map whose values are stored in the map itself, next to
+ * their keys, instead of being pointers owned by the caller.  Each value
+ * is value_size bytes.  For such a map gmap_put copies the value pointed
+ * to into the map, gmap_get and gmap_for_each give pointers to the values
+ * in the map, and gmap_remove destroys the value with its key and returns
+ * NULL.  A pointer to a value stays valid until its key is removed or the
+ * map is destroyed, even as the map grows.  Each value is aligned for any
+ * basic type, as a block from malloc is, so a value may be any struct.
+ *
+ * @param cp a function that take a pointer to a key and returns a pointer to a deep copy of that key
+ * @param comp a pointer to a function that takes two keys and returns the result of comparing them,
+ * with return value as for strcmp
+ * @param h a pointer to a function that takes a pointer to a key and returns its hash code
+ * @param f a pointer to a function that takes a pointer to a copy of a key make by cp and frees it
+ * @param value_size the number of bytes in each value, positive
+ * @return a pointer to the new map or NULL if it could not be created;
+ * it is the caller's responsibility to destroy the map
+ */
+gmap *gmap_create_inline(void *(*cp)(const void *), int (*comp)(const void *, const void *), size_t (*h)(const void *s), void (*f)(void *), size_t value_size);
+
+
 /**
  * Returns the number of (key, value) pairs in the given map.
  *
@@ -35,6 +99,26 @@ gmap *gmap_create(void *(*cp)(const void *), int (*comp)(const void *, const voi
 size_t gmap_size(const gmap *m);
 
 
+/**
+ * Returns the number of times the given map has grown its table and
+ * rehashed its keys.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @return the number of resizes of the map pointed to by m
+ */
+size_t gmap_rehashes(const gmap *m);
+
+
+/**
+ * Fills in statistics about the given map.  This walks every chain, so it
+ * takes time proportional to the capacity plus the size of the map.
+ *
+ * @param m a pointer to a map, non-NULL
+ * @param stats a pointer to the statistics to fill in, non-NULL
+ */
+void gmap_stats(const gmap *m, gmap_statistics *stats);
+
+
 /**
  * Adds a copy of the given key with value to this map.  If the key is
  * already present then the old value is replaced and returned.  The
@@ -50,6 +134,22 @@ size_t gmap_size(const gmap *m);
  */
 void *gmap_put(gmap *m, const void *key, void *value);
 
+
+/**
+ * Returns a pointer to the value stored for the given key in a map made
+ * by gmap_create_inline, adding a copy of the key with a value of all zero
+ * bytes if the key is not present.  The key is searched for once, so a
+ * value can be found or added and then updated in place without further
+ * lookups.
+ *
+ * @param m a pointer to a map made by gmap_create_inline, non-NULL
+ * @param key a pointer to a key, non-NULL
+ * @param added a pointer to where to store whether the key was added, non-NULL
+ * @return a pointer to the value in the map, or NULL if the key could not be added
+ */
+void *gmap_upsert(gmap *m, const void *key, bool *added);
+
+
 /**
  * Removes the given key and its associated value from the given map if
  * the key is present.  The return value is NULL and there is no effect
@@ -0,0 +1,628 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+
+#include "gmap.h"
+#include "cgmap.h"
+#include "string_key.h"
+
+/**
+ * Microbenchmark of gmap and alternative maps on keys shaped like player ids.
+ * For every backend, hash function, key shape and size it times each
+ * put, get (with the requested hit ratio), contains_key and remove
+ * individually and reports the mean and percentiles in nanoseconds, so
+ * the occasional slow put that resizes the table shows up in the tail.
+ * Iteration with for_each and keys is reported per entry, and memory per
+ * entry is measured from the allocator's bytes in use.  Backends that
+ * can be shared between threads are also run with several threads
+ * inserting and then reading disjoint keys, and the combined throughput
+ * is reported.
+ *
+ * usage: gmap_bench [options]
+ *   -n sizes   comma-separated numbers of keys (default 1000,10000,100000,1000000)
+ *   -h ratio   fraction of gets that look up a present key (default 0.5)
+ *   -k shape   only run one key shape (short, generated, long)
+ *   -m map     only run one backend (by name)
+ *   -H hash    only run one hash function (by name)
+ *   -s seed    seed for key generation (default 1)
+ *   -t threads number of threads for the concurrent runs (default 4)
+ *
+ * A new backend is added as a row of backends[] and a new hash function
+ * as a row of hashes[]; every combination is benchmarked.
+ */
+
+/**
+ * The operations of a map under test, with the signatures of gmap
+ */
+typedef struct _map_backend
+{
+    const char *name;
+    bool thread_safe;
+    void *(*create)(size_t (*hash)(const void *));
+    void *(*put)(void *m, const void *key, void *value);
+    void *(*get)(void *m, const void *key);
+    bool (*contains_key)(void *m, const void *key);
+    void *(*remove)(void *m, const void *key);
+    void (*for_each)(void *m, void (*f)(const void *, void *, void *), void *arg);
+    const void **(*keys)(void *m);
+    size_t (*size)(void *m);
+    void (*destroy)(void *m);
+} map_backend;
+
+/**
+ * A hash function for string keys
+ */
+typedef struct _map_hash
+{
+    const char *name;
+    size_t (*hash)(const void *key);
+} map_hash;
+
+/**
+ * A way of making keys
+ */
+typedef struct _key_shape
+{
+    const char *name;
+    void (*make)(char *key, size_t index);
+} key_shape;
+
+//longest key any shape makes, plus the terminator
+#define BENCH_KEY_SIZE 32
+
+//percentiles reported for each timed operation
+static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+#define NUM_PERCENTILES ((int) (sizeof(percentiles) / sizeof(percentiles[0])))
+
+//state of the xorshift64* generator used for keys
+static uint64_t bench_state;
+
+uint64_t bench_next(void);
+size_t fnv1a(const void *key);
+size_t djb2(const void *key);
+void *bench_gmap_create(size_t (*hash)(const void *));
+void *bench_gmap_put(void *m, const void *key, void *value);
+void *bench_gmap_get(void *m, const void *key);
+bool bench_gmap_contains_key(void *m, const void *key);
+void *bench_gmap_remove(void *m, const void *key);
+void bench_gmap_for_each(void *m, void (*f)(const void *, void *, void *), void *arg);
+const void **bench_gmap_keys(void *m);
+size_t bench_gmap_size(void *m);
+void bench_gmap_destroy(void *m);
+void make_short(char *key, size_t index);
+void make_generated(char *key, size_t index);
+void make_long(char *key, size_t index);
+double bench_now(void);
+size_t bench_heap_bytes(void);
+int bench_compare_doubles(const void *a, const void *b);
+void bench_report(const char *op, double *samples, size_t n);
+void bench_count(const void *key, void *value, void *arg);
+void *bench_cgmap_create(size_t (*hash)(const void *));
+void *bench_cgmap_put(void *m, const void *key, void *value);
+void *bench_cgmap_get(void *m, const void *key);
+bool bench_cgmap_contains_key(void *m, const void *key);
+void *bench_cgmap_remove(void *m, const void *key);
+void bench_cgmap_for_each(void *m, void (*f)(const void *, void *, void *), void *arg);
+const void **bench_cgmap_keys(void *m);
+size_t bench_cgmap_size(void *m);
+void bench_cgmap_destroy(void *m);
+void bench_one(const map_backend *b, const map_hash *h, const key_shape *k, size_t n, double hit_ratio);
+void bench_concurrent(const map_backend *b, const map_hash *h, const key_shape *k, size_t n, int threads);
+void *bench_concurrent_task(void *arg);
+
+//shards of the cgmap backend
+#define BENCH_CGMAP_SHARDS 64
+
+static const map_backend backends[] =
+{
+    {"gmap", false, bench_gmap_create, bench_gmap_put, bench_gmap_get, bench_gmap_contains_key, bench_gmap_remove,
+     bench_gmap_for_each, bench_gmap_keys, bench_gmap_size, bench_gmap_destroy},
+    {"cgmap", true, bench_cgmap_create, bench_cgmap_put, bench_cgmap_get, bench_cgmap_contains_key, bench_cgmap_remove,
+     bench_cgmap_for_each, bench_cgmap_keys, bench_cgmap_size, bench_cgmap_destroy}
+};
+
+static const map_hash hashes[] =
+{
+    {"hash29", hash29},
+    {"fnv1a", fnv1a},
+    {"djb2", djb2}
+};
+
+static const key_shape shapes[] =
+{
+    {"short", make_short},
+    {"generated", make_generated},
+    {"long", make_long}
+};
+
+#define NUM_BACKENDS ((int) (sizeof(backends) / sizeof(backends[0])))
+#define NUM_HASHES ((int) (sizeof(hashes) / sizeof(hashes[0])))
+#define NUM_SHAPES ((int) (sizeof(shapes) / sizeof(shapes[0])))
+
+int main(int argc, char *argv[])
+{
+    const char *sizes = "1000,10000,100000,1000000";
+    double hit_ratio = 0.5;
+    const char *only_shape = NULL;
+    const char *only_backend = NULL;
+    const char *only_hash = NULL;
+    uint64_t seed = 1;
+    int threads = 4;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            sizes = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-h") == 0)
+        {
+            hit_ratio = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "-k") == 0)
+        {
+            only_shape = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            only_backend = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-H") == 0)
+        {
+            only_hash = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            seed = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && atoi(argv[i + 1]) > 0)
+        {
+            threads = atoi(argv[i + 1]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: gmap_bench [-n sizes] [-h ratio] [-k shape] [-m map] [-H hash] [-s seed] [-t threads]\n");
+            return 1;
+        }
+    }
+
+    printf("%-8s %-7s %-10s %9s %-12s %9s", "map", "hash", "keys", "n", "op", "mean_ns");
+    for (int p = 0; p < NUM_PERCENTILES; p++)
+    {
+        printf("  p%-6g", percentiles[p]);
+    }
+    printf(" %9s\n", "max_ns");
+
+    for (int b = 0; b < NUM_BACKENDS; b++)
+    {
+        for (int h = 0; h < NUM_HASHES; h++)
+        {
+            for (int k = 0; k < NUM_SHAPES; k++)
+            {
+                if ((only_backend != NULL && strcmp(only_backend, backends[b].name) != 0)
+                    || (only_hash != NULL && strcmp(only_hash, hashes[h].name) != 0)
+                    || (only_shape != NULL && strcmp(only_shape, shapes[k].name) != 0))
+                {
+                    continue;
+                }
+
+                const char *s = sizes;
+                while (*s != '\0')
+                {
+                    size_t n = strtoull(s, (char **) &s, 10);
+                    if (*s == ',')
+                    {
+                        s++;
+                    }
+
+                    //every run makes the same keys
+                    bench_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+                    bench_one(&backends[b], &hashes[h], &shapes[k], n, hit_ratio);
+                    if (backends[b].thread_safe)
+                    {
+                        bench_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+                        bench_concurrent(&backends[b], &hashes[h], &shapes[k], n, threads);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+uint64_t bench_next(void)
+{
+    bench_state ^= bench_state >> 12;
+    bench_state ^= bench_state << 25;
+    bench_state ^= bench_state >> 27;
+    return bench_state * 0x2545F4914F6CDD1DULL;
+}
+
+size_t fnv1a(const void *key)
+{
+    const unsigned char *s = key;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*s != '\0')
+    {
+        h ^= *s;
+        h *= 0x100000001b3ULL;
+        s++;
+    }
+    return h;
+}
+
+size_t djb2(const void *key)
+{
+    const unsigned char *s = key;
+    size_t h = 5381;
+    while (*s != '\0')
+    {
+        h = h * 33 + *s;
+        s++;
+    }
+    return h;
+}
+
+/**
+ * gmap adapted to the backend signatures
+ */
+void *bench_gmap_create(size_t (*hash)(const void *))
+{
+    return gmap_create(duplicate, compare_keys, hash, free);
+}
+
+void *bench_gmap_put(void *m, const void *key, void *value)
+{
+    return gmap_put(m, key, value);
+}
+
+void *bench_gmap_get(void *m, const void *key)
+{
+    return gmap_get(m, key);
+}
+
+bool bench_gmap_contains_key(void *m, const void *key)
+{
+    return gmap_contains_key(m, key);
+}
+
+void *bench_gmap_remove(void *m, const void *key)
+{
+    return gmap_remove(m, key);
+}
+
+void bench_gmap_for_each(void *m, void (*f)(const void *, void *, void *), void *arg)
+{
+    gmap_for_each(m, f, arg);
+}
+
+const void **bench_gmap_keys(void *m)
+{
+    return gmap_keys(m);
+}
+
+size_t bench_gmap_size(void *m)
+{
+    return gmap_size(m);
+}
+
+void bench_gmap_destroy(void *m)
+{
+    gmap_destroy(m);
+}
+
+/**
+ * cgmap adapted to the backend signatures
+ */
+void *bench_cgmap_create(size_t (*hash)(const void *))
+{
+    return cgmap_create(duplicate, compare_keys, hash, free, BENCH_CGMAP_SHARDS);
+}
+
+void *bench_cgmap_put(void *m, const void *key, void *value)
+{
+    return cgmap_put(m, key, value);
+}
+
+void *bench_cgmap_get(void *m, const void *key)
+{
+    return cgmap_get(m, key);
+}
+
+bool bench_cgmap_contains_key(void *m, const void *key)
+{
+    return cgmap_contains_key(m, key);
+}
+
+void *bench_cgmap_remove(void *m, const void *key)
+{
+    return cgmap_remove(m, key);
+}
+
+void bench_cgmap_for_each(void *m, void (*f)(const void *, void *, void *), void *arg)
+{
+    cgmap_for_each(m, f, arg);
+}
+
+const void **bench_cgmap_keys(void *m)
+{
+    return cgmap_keys(m);
+}
+
+size_t bench_cgmap_size(void *m)
+{
+    return cgmap_size(m);
+}
+
+void bench_cgmap_destroy(void *m)
+{
+    cgmap_destroy(m);
+}
+
+//ids like the example file: P followed by a number
+void make_short(char *key, size_t index)
+{
+    sprintf(key, "P%zu", index);
+}
+
+//ids like gen_tournament makes: random capitals, an underscore and the index in base 36
+void make_generated(char *key, size_t index)
+{
+    char digits[16];
+    int n = 0;
+    do
+    {
+        digits[n++] = "0123456789abcdefghijklmnopqrstuvwxyz"[index % 36];
+        index /= 36;
+    } while (index > 0);
+
+    int pad = 4 + bench_next() % 8;
+    for (int i = 0; i < pad; i++)
+    {
+        key[i] = 'A' + bench_next() % 26;
+    }
+    key[pad] = '_';
+    for (int i = 0; i < n; i++)
+    {
+        key[pad + 1 + i] = digits[n - 1 - i];
+    }
+    key[pad + 1 + n] = '\0';
+}
+
+//ids at the 31 character limit that share a long common prefix
+void make_long(char *key, size_t index)
+{
+    sprintf(key, "tournament-entrant-%012zu", index);
+}
+
+double bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+//bytes the allocator has handed out and not had back
+size_t bench_heap_bytes(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+int bench_compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+//function for printing the mean, percentiles and maximum of per-operation times
+void bench_report(const char *op, double *samples, size_t n)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        sum += samples[i];
+    }
+    qsort(samples, n, sizeof(double), bench_compare_doubles);
+
+    printf(" %-12s %9.1f", op, sum / n);
+    for (int p = 0; p < NUM_PERCENTILES; p++)
+    {
+        printf("  %7.0f", samples[(size_t) (percentiles[p] / 100.0 * (n - 1))]);
+    }
+    printf(" %9.0f\n", samples[n - 1]);
+}
+
+void bench_count(const void *key, void *value, void *arg)
+{
+    (*(size_t *) arg)++;
+}
+
+void bench_one(const map_backend *b, const map_hash *h, const key_shape *k, size_t n, double hit_ratio)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    //present keys, then keys that are never added for the misses
+    char *keys = malloc(BENCH_KEY_SIZE * n);
+    char *missing = malloc(BENCH_KEY_SIZE * n);
+    double *samples = malloc(sizeof(double) * n);
+    if (keys == NULL || missing == NULL || samples == NULL)
+    {
+        fprintf(stderr, "gmap_bench: could not allocate %zu keys\n", n);
+        free(keys);
+        free(missing);
+        free(samples);
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        k->make(keys + i * BENCH_KEY_SIZE, i);
+        k->make(missing + i * BENCH_KEY_SIZE, n + i);
+    }
+
+    const char *prefix_fmt = "%-8s %-7s %-10s %9zu";
+    size_t heap_before = bench_heap_bytes();
+    void *m = b->create(h->hash);
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        double start = bench_now();
+        b->put(m, keys + i * BENCH_KEY_SIZE, keys + i * BENCH_KEY_SIZE);
+        samples[i] = bench_now() - start;
+    }
+    bench_report("put", samples, n);
+
+    size_t heap_after = bench_heap_bytes();
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *key = ((double) (bench_next() >> 11) / 9007199254740992.0 < hit_ratio
+                           ? keys + (bench_next() % n) * BENCH_KEY_SIZE
+                           : missing + (bench_next() % n) * BENCH_KEY_SIZE);
+        double start = bench_now();
+        b->get(m, key);
+        samples[i] = bench_now() - start;
+    }
+    bench_report("get", samples, n);
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *key = keys + (bench_next() % n) * BENCH_KEY_SIZE;
+        double start = bench_now();
+        b->contains_key(m, key);
+        samples[i] = bench_now() - start;
+    }
+    bench_report("contains_key", samples, n);
+
+    //iteration is timed as a whole and reported per entry
+    size_t count = 0;
+    double start = bench_now();
+    b->for_each(m, bench_count, &count);
+    double each_ns = (bench_now() - start) / n;
+
+    start = bench_now();
+    const void **key_arr = b->keys(m);
+    double keys_ns = (bench_now() - start) / n;
+    free(key_arr);
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    printf(" %-12s %9.1f\n", "for_each", each_ns);
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    printf(" %-12s %9.1f\n", "keys", keys_ns);
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        double start = bench_now();
+        b->remove(m, keys + i * BENCH_KEY_SIZE);
+        samples[i] = bench_now() - start;
+    }
+    bench_report("remove", samples, n);
+
+    printf(prefix_fmt, b->name, h->name, k->name, n);
+    if (heap_after > heap_before)
+    {
+        printf(" %-12s %9.1f\n", "bytes/entry", (double) (heap_after - heap_before) / n);
+    }
+    else
+    {
+        printf(" %-12s %9s\n", "bytes/entry", "n/a");
+    }
+
+    b->destroy(m);
+    free(keys);
+    free(missing);
+    free(samples);
+}
+
+/**
+ * The keys one thread of a concurrent run inserts and then reads
+ */
+typedef struct _bench_task
+{
+    const map_backend *b;
+    void *m;
+    const char *keys;
+    size_t first;
+    size_t last;
+} bench_task;
+
+void *bench_concurrent_task(void *arg)
+{
+    bench_task *task = arg;
+    for (size_t i = task->first; i < task->last; i++)
+    {
+        task->b->put(task->m, task->keys + i * BENCH_KEY_SIZE, NULL);
+    }
+
+    for (size_t i = task->first; i < task->last; i++)
+    {
+        task->b->get(task->m, task->keys + i * BENCH_KEY_SIZE);
+    }
+
+    return NULL;
+}
+
+//function for timing threads that each put and then get their own share of the keys
+void bench_concurrent(const map_backend *b, const map_hash *h, const key_shape *k, size_t n, int threads)
+{
+    char *keys = malloc(BENCH_KEY_SIZE * n);
+    bench_task *tasks = malloc(sizeof(bench_task) * threads);
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    if (keys == NULL || tasks == NULL || ids == NULL)
+    {
+        free(keys);
+        free(tasks);
+        free(ids);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        k->make(keys + i * BENCH_KEY_SIZE, i);
+    }
+
+    void *m = b->create(h->hash);
+    double start = bench_now();
+    for (int t = 0; t < threads; t++)
+    {
+        tasks[t].b = b;
+        tasks[t].m = m;
+        tasks[t].keys = keys;
+        tasks[t].first = n * t / threads;
+        tasks[t].last = n * (t + 1) / threads;
+        pthread_create(&ids[t], NULL, bench_concurrent_task, &tasks[t]);
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(ids[t], NULL);
+    }
+    double elapsed = bench_now() - start;
+
+    printf("%-8s %-7s %-10s %9zu %-12s %9.1f  (%d threads, %.0f ops/s)\n", b->name, h->name, k->name, n,
+           "put+get/mt", elapsed / (2.0 * n), threads, 2.0 * n / (elapsed / 1e9));
+
+    b->destroy(m);
+    free(keys);
+    free(tasks);
+    free(ids);
+}
@@ -0,0 +1,286 @@
+#include "incremental.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "reorder.h"
+
+//initial number of matchups and of matchups per player the arrays can hold
+#define TOURNAMENT_INITIAL_CAPACITY 16
+
+/**
+ * A matchup and the outcome it contributed to the standings
+ *
+ * @param player1 the index of the first player
+ * @param player2 the index of the second player
+ * @param outcome the outcome from the first player's point of view
+ */
+typedef struct _matchup
+{
+    size_t player1;
+    size_t player2;
+    pair_outcome outcome;
+} matchup;
+
+/**
+ * The indices of the matchups one player is in
+ *
+ * @param matchups the indices into the tournament's matchups
+ * @param size the number of matchups
+ * @param capacity the number of matchups the array can hold
+ */
+typedef struct _matchup_list
+{
+    size_t *matchups;
+    size_t size;
+    size_t capacity;
+} matchup_list;
+
+/**
+ * @param classes the table of distributions
+ * @param weights the weight of each battlefield
+ * @param uniform true if every battlefield has the same weight, so matchups are scored by counting
+ * @param half half the weight of every battlefield when uniform is true
+ * @param outcomes a buffer for the outcome of each battlefield
+ * @param num_players the number of players
+ * @param player_classes the class of each player
+ * @param standings the standing of each player
+ * @param stale whether each player's standing is out of date until it is added up again from its matchups
+ * @param lists the matchups of each player
+ * @param matchups every matchup added so far
+ * @param size the number of matchups
+ * @param capacity the number of matchups the array can hold
+ */
+struct _tournament
+{
+    const dist_table *classes;
+    const double *weights;
+    bool uniform;
+    double half;
+    signed char *outcomes;
+    size_t num_players;
+    size_t *player_classes;
+    standing *standings;
+    bool *stale;
+    matchup_list *lists;
+    matchup *matchups;
+    size_t size;
+    size_t capacity;
+};
+
+void tournament_score(tournament *t, matchup *m);
+void tournament_apply(tournament *t, const matchup *m, double sign);
+void tournament_total(tournament *t, size_t player);
+bool tournament_list_add(matchup_list *list, size_t index);
+
+tournament *tournament_create(const dist_table *classes, const double *weights, size_t num_players, const size_t *player_classes)
+{
+    tournament *result = malloc(sizeof(tournament));
+
+    if (result != NULL)
+    {
+        result->classes = classes;
+        result->weights = weights;
+        result->uniform = uniform_weights(weights, dist_table_battlefields(classes), &result->half);
+        result->num_players = num_players;
+        result->size = 0;
+        result->capacity = TOURNAMENT_INITIAL_CAPACITY;
+        result->outcomes = malloc(dist_table_battlefields(classes));
+        result->player_classes = malloc(sizeof(size_t) * num_players);
+        result->standings = calloc(num_players, sizeof(standing));
+        result->stale = calloc(num_players, sizeof(bool));
+        result->lists = calloc(num_players, sizeof(matchup_list));
+        result->matchups = malloc(sizeof(matchup) * result->capacity);
+
+        if (result->outcomes == NULL || result->player_classes == NULL || result->standings == NULL || result->stale == NULL
+            || result->lists == NULL || result->matchups == NULL)
+        {
+            tournament_destroy(result);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < num_players; i++)
+        {
+            result->player_classes[i] = player_classes[i];
+        }
+    }
+
+    return result;
+}
+
+//function for scoring a matchup with the players' current classes
+void tournament_score(tournament *t, matchup *m)
+{
+    int battlefields = dist_table_battlefields(t->classes);
+    if (t->uniform)
+    {
+        dist_table_score_uniform(t->classes, t->player_classes[m->player1], t->player_classes[m->player2], t->half, &m->outcome);
+    }
+    else
+    {
+        dist_table_compare(t->classes, t->player_classes[m->player1], t->player_classes[m->player2], t->outcomes);
+        score_matchup(t->outcomes, battlefields, t->weights, &m->outcome);
+    }
+
+    //a player facing itself shares one running score, so both sides get the whole total
+    if (m->player1 == m->player2)
+    {
+        m->outcome.score1 = score_self_matchup(t->weights, battlefields);
+        m->outcome.score2 = m->outcome.score1;
+    }
+}
+
+//function for adding (sign 1) or removing (sign -1) a matchup's outcome from the standings
+void tournament_apply(tournament *t, const matchup *m, double sign)
+{
+    standing *s1 = &t->standings[m->player1];
+    standing *s2 = &t->standings[m->player2];
+
+    s1->overall_score += sign * m->outcome.score1;
+    s2->overall_score += sign * m->outcome.score2;
+    s1->wins += sign * m->outcome.wins1;
+    s2->wins += sign * (1 - m->outcome.wins1);
+    s1->games += sign;
+    s2->games += sign;
+}
+
+//function for adding up a player's standing again from its matchups, in the order they were added
+void tournament_total(tournament *t, size_t player)
+{
+    standing *s = &t->standings[player];
+    s->wins = 0;
+    s->overall_score = 0;
+    s->games = 0;
+
+    //a player facing itself takes both sides, first side first, as tournament_apply adds them
+    const matchup_list *list = &t->lists[player];
+    for (size_t i = 0; i < list->size; i++)
+    {
+        const matchup *m = &t->matchups[list->matchups[i]];
+        if (m->player1 == player)
+        {
+            s->overall_score += m->outcome.score1;
+            s->wins += m->outcome.wins1;
+            s->games++;
+        }
+        if (m->player2 == player)
+        {
+            s->overall_score += m->outcome.score2;
+            s->wins += 1 - m->outcome.wins1;
+            s->games++;
+        }
+    }
+}
+
+//function for appending a matchup index to a player's list
+bool tournament_list_add(matchup_list *list, size_t index)
+{
+    if (list->size == list->capacity)
+    {
+        size_t capacity = (list->capacity == 0 ? TOURNAMENT_INITIAL_CAPACITY : list->capacity * 2);
+        size_t *matchups = realloc(list->matchups, sizeof(size_t) * capacity);
+        if (matchups == NULL)
+        {
+            return false;
+        }
+        list->matchups = matchups;
+        list->capacity = capacity;
+    }
+
+    list->matchups[list->size] = index;
+    list->size++;
+
+    return true;
+}
+
+bool tournament_add_matchup(tournament *t, size_t player1, size_t player2)
+{
+    if (t->size == t->capacity)
+    {
+        matchup *matchups = realloc(t->matchups, sizeof(matchup) * t->capacity * 2);
+        if (matchups == NULL)
+        {
+            return false;
+        }
+        t->matchups = matchups;
+        t->capacity *= 2;
+    }
+
+    //a player facing itself is listed once so its matchup is rescored once
+    if (!tournament_list_add(&t->lists[player1], t->size)
+        || (player1 != player2 && !tournament_list_add(&t->lists[player2], t->size)))
+    {
+        return false;
+    }
+
+    matchup *m = &t->matchups[t->size];
+    m->player1 = player1;
+    m->player2 = player2;
+    tournament_score(t, m);
+    tournament_apply(t, m, 1.0);
+    t->size++;
+
+    return true;
+}
+
+void tournament_update(tournament *t, size_t player, size_t cls)
+{
+    t->player_classes[player] = cls;
+
+    //when every total is exact in any order, each old outcome is taken off and the new
+    //one added; otherwise that would leave rounding error behind, so the player and
+    //its opponents are added up again from their matchups when next asked for
+    bool exact = reorder_is_exact(t->weights, dist_table_battlefields(t->classes), t->size);
+    matchup_list *list = &t->lists[player];
+    for (size_t i = 0; i < list->size; i++)
+    {
+        matchup *m = &t->matchups[list->matchups[i]];
+        if (exact)
+        {
+            tournament_apply(t, m, -1.0);
+            tournament_score(t, m);
+            tournament_apply(t, m, 1.0);
+        }
+        else
+        {
+            tournament_score(t, m);
+            t->stale[m->player1] = true;
+            t->stale[m->player2] = true;
+        }
+    }
+}
+
+const standing *tournament_standing(tournament *t, size_t player)
+{
+    if (t->stale[player])
+    {
+        tournament_total(t, player);
+        t->stale[player] = false;
+    }
+    return &t->standings[player];
+}
+
+void tournament_destroy(tournament *t)
+{
+    if (t == NULL)
+    {
+        return;
+    }
+
+    if (t->lists != NULL)
+    {
+        for (size_t i = 0; i < t->num_players; i++)
+        {
+            free(t->lists[i].matchups);
+        }
+    }
+
+    free(t->outcomes);
+    free(t->player_classes);
+    free(t->standings);
+    free(t->stale);
+    free(t->lists);
+    free(t->matchups);
+    free(t);
+}
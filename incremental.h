@@ -0,0 +1,94 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "distribution.h"
+
+struct _tournament;
+typedef struct _tournament tournament;
+
+/**
+ * A player's accumulated results
+ *
+ * @param wins the wins so far, ties count as half a win
+ * @param overall_score the total score so far
+ * @param games the number of games played
+ */
+typedef struct _standing
+{
+    double wins;
+    double overall_score;
+    double games;
+} standing;
+
+/**
+ * Creates a tournament between players whose distributions are classes of
+ * the given table.  The tournament remembers the outcome of every matchup
+ * and which matchups each player is in, so that when one player's
+ * distribution changes only that player's matchups are scored again.
+ * The table and weights must outlive the tournament.
+ *
+ * @param classes a pointer to the table of distributions, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param num_players the number of players, indexed from 0
+ * @param player_classes the class of each player, non-NULL
+ * @return a pointer to the new tournament or NULL if it could not be created;
+ * it is the caller's responsibility to destroy the tournament
+ */
+tournament *tournament_create(const dist_table *classes, const double *weights, size_t num_players, const size_t *player_classes);
+
+
+/**
+ * Scores a matchup between two players and adds it to their standings.
+ *
+ * @param t a pointer to a tournament, non-NULL
+ * @param player1 the index of a player
+ * @param player2 the index of a player, which may equal player1
+ * @return true if the matchup was added, false if there was an allocation error
+ */
+bool tournament_add_matchup(tournament *t, size_t player1, size_t player2);
+
+
+/**
+ * Gives a player a new distribution class and rescores only the matchups
+ * that player is in, so standings equal a full rescoring exactly whatever
+ * the weights.  When every weight is a multiple of one half and the totals
+ * are small enough for reorder_is_exact, the standings of the player and
+ * its opponents are patched by taking off each old outcome and adding the
+ * new one, and the cost is the number of the player's matchups times the
+ * number of battlefields.  Otherwise patching would leave rounding error
+ * behind, so those standings are marked out of date instead and
+ * tournament_standing adds each up again from its matchups, which costs
+ * up to the sum of the opponents' numbers of matchups the first time the
+ * standings are read after the update.
+ *
+ * @param t a pointer to a tournament, non-NULL
+ * @param player the index of a player
+ * @param cls the index of the player's new class
+ */
+void tournament_update(tournament *t, size_t player, size_t cls);
+
+
+/**
+ * Returns the standing of a player, first adding it up again from the
+ * player's matchups if an update under weights that are not multiples of
+ * one half has put it out of date.  The pointer is
+ * valid until the tournament is changed or destroyed.
+ *
+ * @param t a pointer to a tournament, non-NULL
+ * @param player the index of a player
+ * @return a pointer to the player's standing
+ */
+const standing *tournament_standing(tournament *t, size_t player);
+
+
+/**
+ * Destroys the given tournament.  There is no effect if the given pointer is NULL.
+ *
+ * @param t a pointer to a tournament, or NULL
+ */
+void tournament_destroy(tournament *t);
+
+#endif
@@ -0,0 +1,2091 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "libblotto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gmap.h"
+#include "entry.h"
+#include "string_key.h"
+#include "distribution.h"
+#include "loader.h"
+#include "query.h"
+#include "incremental.h"
+#include "stats.h"
+#include "checkpoint.h"
+#include "reorder.h"
+#include "schedule.h"
+#include "matrix.h"
+#include "estimate.h"
+#include "optimize.h"
+
+//the most matchups a schedule makes at a time
+#define SCHEDULE_BLOCK 65536
+
+//the most pairings of classes a pair cache keeps, and the most bytes of outcomes it keeps
+#define PAIR_CACHE_SLOTS 4096
+#define PAIR_CACHE_BYTES (1 << 20)
+
+/**
+ * What the field knows about each player, stored as the value for the player's id
+ *
+ * @param index the position of the player in the order the field was read
+ * @param cls the index of the player's distribution class
+ */
+typedef struct _player
+{
+    size_t index;
+    size_t cls;
+} player;
+
+/**
+ * @param players the ids of the players, mapped to player structs
+ * @param classes the unique distributions, shared by all players that submitted them
+ * @param battlefields the number of battlefields
+ */
+struct _blotto_field
+{
+    gmap *players;
+    dist_table *classes;
+    int battlefields;
+};
+
+/**
+ * @param standings the standings
+ * @param size the number of standings
+ */
+struct _blotto_results
+{
+    blotto_standing *standings;
+    size_t size;
+};
+
+//outcomes of reading one line of a matchup file
+typedef enum matchup_status {MATCHUP_OK, MATCHUP_END, MATCHUP_WRONG, MATCHUP_ISSUE} matchup_status;
+
+//reads the ids of the next matchup from the matchup file
+matchup_status read_matchup(FILE* matchup_file, char *id1, char *id2);
+
+//checks the first character of a matchup file, which cannot be a space or an empty line
+bool matchup_file_starts_well(FILE *matchup_file);
+
+//makes results from the standings of the players in a map of ids to standings
+blotto_results *results_from_map(gmap *point_map);
+
+//moves a standing out of a map and onto the end of some results
+void move_standing(const void *key, void *value, void *arg);
+
+//makes results of the players with games from totals kept k to a player, taking the j-th of each
+blotto_results *results_from_totals(const char **ids, size_t n, const double *wins, const double *scores, const double *games, size_t k, size_t j);
+
+/**
+ * The outcome of the last pairing of distribution classes scored, kept for
+ * when the next matchup repeats it
+ *
+ * @param outcome the outcome, lower class first
+ * @param low the lower class of the pairing
+ * @param high the higher class of the pairing
+ * @param valid false until a pairing has been scored
+ */
+typedef struct _last_outcome
+{
+    pair_outcome outcome;
+    size_t low;
+    size_t high;
+    bool valid;
+} last_outcome;
+
+/**
+ * Outcomes of pairings of distribution classes, kept in a fixed number of
+ * slots chosen by a hash of the pairing so that a pairing replaces the one
+ * before it in its slot.  The cache never grows, so a field whose pairings
+ * rarely repeat costs a hash and a comparison per matchup and no more.
+ *
+ * @param lows the lower class of the pairing in each slot, SIZE_MAX for an empty slot
+ * @param highs the higher class of the pairing in each slot
+ * @param values the outcome of each slot's pairing, one after the other
+ * @param mask the number of slots less one, which is a power of two less one
+ * @param size the number of bytes of each outcome
+ */
+typedef struct _pair_cache
+{
+    size_t *lows;
+    size_t *highs;
+    unsigned char *values;
+    size_t mask;
+    size_t size;
+} pair_cache;
+
+//makes an empty pair cache for outcomes of the given size, or NULL if there was an allocation error
+pair_cache *pair_cache_create(size_t size);
+
+//finds the slot for a pairing, which holds its outcome if hit is set and is the caller's to fill otherwise
+void *pair_cache_slot(pair_cache *c, size_t low, size_t high, bool *hit);
+
+//frees a pair cache
+void pair_cache_destroy(pair_cache *c);
+
+//plays matchups given by player index, adding to each player's totals by index
+void play_pairs(const blotto_field *f, const double *weights, const size_t *player_classes, const matchup_pair *pairs, size_t n,
+                double *wins, double *scores, double *games, signed char *outcomes, last_outcome *last);
+
+//fills in the id and class of each player by its index, from the array of the map's keys
+void players_by_index(gmap *all_players, const char **key_arr, const char **ids, size_t *player_classes);
+
+/**
+ * Where restore_standing puts the results read from a snapshot
+ *
+ * @param all_players the field's players, which the results must be of
+ * @param point_map the map of ids to standings
+ */
+typedef struct _restore_arg
+{
+    gmap *all_players;
+    gmap *point_map;
+} restore_arg;
+
+//adds a player's results read from a snapshot to the results being played
+bool restore_standing(const char *id, double wins, double overall_score, double games, void *arg);
+
+//reads every update until a blank line or EOF, checking that each is of a player of the field
+blotto_error read_updates(const blotto_field *f, FILE *update_file, entry **updates, size_t *count);
+
+//makes a snapshot of the results so far, or NULL if the offset or the matchup file is unknown
+checkpoint *snapshot_results(gmap *point_map, long offset, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size);
+
+//adds the standing to a snapshot
+void snapshot_standing(const void *key, void *value, void *arg);
+
+//opens a buffer as a stream for reading
+FILE *open_buffer(const char *buffer, size_t len);
+
+//stores an error where the caller asked for it
+void set_error(blotto_error *error, blotto_error value);
+
+//functions for qsort comparison
+int cmpfunc_win(const void *key1, const void *key2);
+int cmpfunc_score(const void *key1, const void *key2);
+
+//functions for freeing gmaps
+void free_fnc(gmap *all_players);
+void free_fnc2(gmap *point_map);
+void free_standing_id(const void *key, void *value, void *arg);
+
+const char *blotto_strerror(blotto_error error)
+{
+    switch (error)
+    {
+    case BLOTTO_OK:
+        return "no error";
+    case BLOTTO_NO_MEMORY:
+        return "could not allocate memory";
+    case BLOTTO_INVALID_DISTRIBUTION:
+        return "Invalid Distribution";
+    case BLOTTO_DUPLICATE_PLAYER:
+        return "Duplicate Player";
+    case BLOTTO_EMPTY_DISTRIBUTIONS:
+        return "Empty Distribution File";
+    case BLOTTO_INVALID_MATCHUPS:
+        return "Invalid Matchup File";
+    case BLOTTO_INVALID_PLAYER:
+        return "Invalid Player";
+    case BLOTTO_WRONG_MATCHUPS:
+        return "Wrong Matchup File";
+    case BLOTTO_MATCHUP_ISSUE:
+        return "Issue with Matchup File";
+    case BLOTTO_EMPTY_MATCHUPS:
+        return "Empty Matchup File";
+    case BLOTTO_INVALID_CANDIDATE:
+        return "Invalid Candidate";
+    case BLOTTO_EMPTY_CANDIDATES:
+        return "Empty Candidate File";
+    case BLOTTO_INVALID_UPDATE:
+        return "Invalid Update";
+    case BLOTTO_INVALID_CHECKPOINT:
+        return "Invalid Checkpoint";
+    case BLOTTO_INVALID_SCHEDULE:
+        return "Invalid Schedule";
+    case BLOTTO_INVALID_MATRIX:
+        return "Invalid Matrix";
+    case BLOTTO_WRITE_FAILED:
+        return "Write Failed";
+    case BLOTTO_INVALID_SAMPLING:
+        return "Invalid Sampling";
+    case BLOTTO_INVALID_SEARCH:
+        return "Invalid Search";
+    }
+
+    return "unknown error";
+}
+
+blotto_field *blotto_field_load(FILE *in, int battlefields, int threads, blotto_error *error)
+{
+    blotto_field *f = malloc(sizeof(blotto_field));
+    if (f == NULL)
+    {
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+    f->battlefields = battlefields;
+    f->players = gmap_create(duplicate, compare_keys, hash29, free);
+    f->classes = dist_table_create(battlefields);
+    if (f->players == NULL || f->classes == NULL)
+    {
+        if (f->players != NULL)
+        {
+            gmap_destroy(f->players);
+        }
+        if (f->classes != NULL)
+        {
+            dist_table_destroy(f->classes);
+        }
+        free(f);
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+
+    stats_switch(PHASE_PARSE_DISTRIBUTIONS);
+    loader_result lines;
+    loader_status status = loader_read(in, BLOTTO_MAX_ID, battlefields, threads, &lines);
+    STATS_ADD(COUNTER_BYTES_READ, lines.bytes);
+
+    //the players are added in the order they were read, so a duplicate
+    //before an invalid line is reported first, as when reading line by line
+    blotto_error result = BLOTTO_OK;
+    for (size_t i = 0; i < lines.size && result == BLOTTO_OK; i++)
+    {
+        STATS_ADD(COUNTER_LOOKUPS, 1);
+        if (gmap_contains_key(f->players, lines.entries[i].id))
+        {
+            result = BLOTTO_DUPLICATE_PLAYER;
+        }
+        else
+        {
+            //players point to the class of their distribution instead of keeping a copy
+            player *p = malloc(sizeof(player));
+            size_t cls = dist_table_intern(f->classes, lines.entries[i].distribution);
+            if (p == NULL || cls == DIST_TABLE_ERROR || gmap_put(f->players, lines.entries[i].id, p) == gmap_error)
+            {
+                free(p);
+                result = BLOTTO_NO_MEMORY;
+            }
+            else
+            {
+                p->index = i;
+                p->cls = cls;
+                STATS_ADD(COUNTER_LOOKUPS, 1);
+                STATS_ADD(COUNTER_ALLOCATIONS, 3);
+            }
+        }
+    }
+    loader_result_destroy(&lines);
+
+    if (result == BLOTTO_OK && status == LOADER_INVALID)
+    {
+        result = BLOTTO_INVALID_DISTRIBUTION;
+    }
+    else if (result == BLOTTO_OK && status == LOADER_NO_MEMORY)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+    else if (result == BLOTTO_OK && gmap_size(f->players) == 0)
+    {
+        result = BLOTTO_EMPTY_DISTRIBUTIONS;
+    }
+
+    if (result != BLOTTO_OK)
+    {
+        blotto_field_destroy(f);
+        set_error(error, result);
+        return NULL;
+    }
+
+    STATS_ADD(COUNTER_REHASHES, gmap_rehashes(f->players));
+    stats_add_map("players", f->players);
+
+    set_error(error, BLOTTO_OK);
+    return f;
+}
+
+blotto_field *blotto_field_parse(const char *buffer, size_t len, int battlefields, int threads, blotto_error *error)
+{
+    FILE *in = open_buffer(buffer, len);
+    if (in == NULL)
+    {
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+
+    blotto_field *f = blotto_field_load(in, battlefields, threads, error);
+    fclose(in);
+    return f;
+}
+
+blotto_field *blotto_field_copy(const blotto_field *f, blotto_error *error)
+{
+    size_t n = gmap_size(f->players);
+    blotto_field *copy = malloc(sizeof(blotto_field));
+    const char **ids = malloc(sizeof(char*) * (n > 0 ? n : 1));
+    const char **key_arr = (const char**) gmap_keys(f->players);
+    int *distribution = malloc(sizeof(int) * f->battlefields);
+    if (copy != NULL)
+    {
+        copy->battlefields = f->battlefields;
+        copy->players = gmap_create(duplicate, compare_keys, hash29, free);
+        copy->classes = dist_table_create(f->battlefields);
+    }
+    if (copy == NULL || ids == NULL || key_arr == NULL || distribution == NULL || copy->players == NULL || copy->classes == NULL)
+    {
+        if (copy != NULL && copy->players != NULL)
+        {
+            gmap_destroy(copy->players);
+        }
+        if (copy != NULL && copy->classes != NULL)
+        {
+            dist_table_destroy(copy->classes);
+        }
+        free(copy);
+        free(ids);
+        free(key_arr);
+        free(distribution);
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+
+    //players are added in the order the field was read, so classes are numbered the same way
+    for (size_t i = 0; i < n; i++)
+    {
+        ids[((player*) gmap_get(f->players, key_arr[i]))->index] = key_arr[i];
+    }
+    free(key_arr);
+
+    blotto_error result = BLOTTO_OK;
+    for (size_t i = 0; i < n && result == BLOTTO_OK; i++)
+    {
+        player *p = malloc(sizeof(player));
+        dist_table_get(f->classes, ((player*) gmap_get(f->players, ids[i]))->cls, distribution);
+        size_t cls = dist_table_intern(copy->classes, distribution);
+        if (p == NULL || cls == DIST_TABLE_ERROR || gmap_put(copy->players, ids[i], p) == gmap_error)
+        {
+            free(p);
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            p->index = i;
+            p->cls = cls;
+        }
+    }
+    free(ids);
+    free(distribution);
+
+    if (result != BLOTTO_OK)
+    {
+        blotto_field_destroy(copy);
+        copy = NULL;
+    }
+
+    set_error(error, result);
+    return copy;
+}
+
+size_t blotto_field_size(const blotto_field *f)
+{
+    return gmap_size(f->players);
+}
+
+int blotto_field_battlefields(const blotto_field *f)
+{
+    return f->battlefields;
+}
+
+blotto_error blotto_field_update(blotto_field *f, const char *id, const int *distribution)
+{
+    player *p = gmap_get(f->players, id);
+    if (p == NULL)
+    {
+        return BLOTTO_INVALID_UPDATE;
+    }
+
+    //intern first so that a class shared with the old distribution is not freed and remade
+    size_t cls = dist_table_intern(f->classes, distribution);
+    if (cls == DIST_TABLE_ERROR)
+    {
+        return BLOTTO_NO_MEMORY;
+    }
+    dist_table_release(f->classes, p->cls);
+    p->cls = cls;
+
+    return BLOTTO_OK;
+}
+
+void blotto_field_destroy(blotto_field *f)
+{
+    free_fnc(f->players);
+    dist_table_destroy(f->classes);
+    free(f);
+}
+
+blotto_results *blotto_play(const blotto_field *f, const double *weights, FILE *matchup_file, blotto_error *error)
+{
+    return blotto_play_checkpointed(f, weights, matchup_file, NULL, error);
+}
+
+blotto_results *blotto_play_checkpointed(const blotto_field *f, const double *weights, FILE *matchup_file, const blotto_checkpoint *cp, blotto_error *error)
+{
+    gmap *all_players = f->players;
+    dist_table *classes = f->classes;
+    int battlefields = f->battlefields;
+
+    //gmap for ids and result structs
+    gmap *point_map = gmap_create_inline(duplicate, compare_keys, hash29, free, sizeof(blotto_standing));
+
+    //strings to store ids fread form matchup file
+    char id1[BLOTTO_MAX_ID];
+    char id2[BLOTTO_MAX_ID];
+
+    //status of reading each matchup
+    matchup_status status = MATCHUP_END;
+
+    //distribution classes of the two competitors
+    size_t cls1;
+    size_t cls2;
+
+    //game structs
+    blotto_standing *game1;
+    blotto_standing *game2;
+
+    //outcomes of recent pairings of classes, lower class first
+    pair_cache *pairs = pair_cache_create(sizeof(pair_outcome));
+    bool hit;
+    pair_outcome swapped;
+
+    //result of each battlefield for the matchup being scored
+    signed char *outcomes = malloc(battlefields);
+    pair_outcome *outcome;
+
+    //with every battlefield weighted the same, matchups are scored by counting battlefields
+    double half;
+    bool uniform = uniform_weights(weights, battlefields, &half);
+    double self_score = score_self_matchup(weights, battlefields);
+
+    //progress is saved every cp->every matchups by a thread of its own
+    checkpointer *writer = NULL;
+    size_t since_checkpoint = 0;
+    bool resumed = false;
+
+    //snapshots are only resumed against the matchup file they were taken of, which a
+    //stream that is not a file cannot be, so no snapshot taken of one would match
+    checkpoint_source source = {0};
+    bool identified = (cp != NULL && checkpoint_identify(matchup_file, &source));
+
+    blotto_error result = BLOTTO_OK;
+    if (point_map == NULL || pairs == NULL || outcomes == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //pick up the results and place in the matchup file where the last snapshot left off
+    else if (cp != NULL && cp->resume)
+    {
+        long offset;
+        restore_arg arg = {all_players, point_map};
+        checkpoint_status restored = checkpoint_read(cp->path, &source, battlefields, weights, gmap_size(all_players), &offset, restore_standing, &arg);
+        if (restored == CHECKPOINT_INVALID || (restored == CHECKPOINT_OK && fseek(matchup_file, offset, SEEK_SET) != 0))
+        {
+            result = BLOTTO_INVALID_CHECKPOINT;
+        }
+        resumed = (restored == CHECKPOINT_OK);
+    }
+
+    //check whether there is a blank space or empty line in the beginning of the file
+    if (result == BLOTTO_OK && !resumed && !matchup_file_starts_well(matchup_file))
+    {
+        result = BLOTTO_INVALID_MATCHUPS;
+    }
+
+    if (result == BLOTTO_OK && cp != NULL && (writer = checkpointer_create(cp->path)) == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //cloop through matchup file, timing the phases of only some matchups
+    stats_switch(PHASE_PARSE_MATCHUPS);
+    stats_sample_begin();
+    while (result == BLOTTO_OK && (status = read_matchup(matchup_file, id1, id2)) == MATCHUP_OK)
+    {
+        stats_sample_tick();
+        stats_switch(PHASE_LOOKUPS);
+        STATS_ADD(COUNTER_MATCHUPS, 1);
+
+        //checks whether ids have a distribtuion
+        player *p1 = gmap_get(all_players, id1);
+        player *p2 = gmap_get(all_players, id2);
+        STATS_ADD(COUNTER_LOOKUPS, 2);
+        if (p1 != NULL && p2 != NULL)
+        {
+            //standings live in the map, and one search finds or adds each
+            bool added;
+            game1 = gmap_upsert(point_map, id1, &added);
+            STATS_ADD(COUNTER_LOOKUPS, 1);
+            STATS_ADD(COUNTER_ALLOCATIONS, (game1 != NULL && added ? 2 : 0));
+            if (game1 != NULL && added && (game1->id = malloc(sizeof(char) * BLOTTO_MAX_ID)) != NULL)
+            {
+                strcpy(game1->id, id1);
+                STATS_ADD(COUNTER_ALLOCATIONS, 1);
+            }
+
+            game2 = gmap_upsert(point_map, id2, &added);
+            STATS_ADD(COUNTER_LOOKUPS, 1);
+            STATS_ADD(COUNTER_ALLOCATIONS, (game2 != NULL && added ? 2 : 0));
+            if (game2 != NULL && added && (game2->id = malloc(sizeof(char) * BLOTTO_MAX_ID)) != NULL)
+            {
+                strcpy(game2->id, id2);
+                STATS_ADD(COUNTER_ALLOCATIONS, 1);
+            }
+
+            //a standing whose id could not be copied has no id to free or report
+            if (game1 == NULL || game2 == NULL || game1->id == NULL || game2->id == NULL)
+            {
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+
+            //matchups are evaluated between distribution classes, not players
+            cls1 = p1->cls;
+            cls2 = p2->cls;
+
+            //look up the outcome of this pairing, scoring it only if it is not still cached
+            stats_switch(PHASE_SCORING);
+            size_t low = (cls1 <= cls2 ? cls1 : cls2);
+            size_t high = (cls1 <= cls2 ? cls2 : cls1);
+            outcome = pair_cache_slot(pairs, low, high, &hit);
+
+            if (hit)
+            {
+                STATS_ADD(COUNTER_CACHE_HITS, 1);
+            }
+
+            else
+            {
+                STATS_ADD(COUNTER_CACHE_MISSES, 1);
+                if (uniform)
+                {
+                    dist_table_score_uniform(classes, low, high, half, outcome);
+                }
+                else
+                {
+                    dist_table_compare(classes, low, high, outcomes);
+                    score_matchup(outcomes, battlefields, weights, outcome);
+                }
+            }
+
+            //the cached outcome is stored lower class first
+            if (cls1 > cls2)
+            {
+                swapped.score1 = outcome->score2;
+                swapped.score2 = outcome->score1;
+                swapped.wins1 = 1 - outcome->wins1;
+                outcome = &swapped;
+            }
+
+            //a player facing itself shares one running score, so both sides get the whole total
+            if (strcmp(id1, id2) == 0)
+            {
+                swapped.score1 = self_score;
+                swapped.score2 = self_score;
+                swapped.wins1 = outcome->wins1;
+                outcome = &swapped;
+            }
+
+            stats_switch(PHASE_LOOKUPS);
+
+            //add the scores to the overall score
+            game1->overall_score += outcome->score1;
+            game2->overall_score += outcome->score2;
+
+            //updates result structs for both ids
+            game1->wins += outcome->wins1;
+            game2->wins += 1 - outcome->wins1;
+            game1->games++;
+            game2->games++;
+
+            //a snapshot is only taken when the last one has been written, so play never waits
+            if (writer != NULL && ++since_checkpoint >= cp->every && checkpointer_idle(writer))
+            {
+                checkpoint *snapshot = snapshot_results(point_map, ftell(matchup_file), (identified ? &source : NULL), battlefields, weights, gmap_size(all_players));
+                if (snapshot != NULL)
+                {
+                    checkpointer_submit(writer, snapshot);
+                }
+                since_checkpoint = 0;
+            }
+            stats_switch(PHASE_PARSE_MATCHUPS);
+        }
+
+        else
+        {
+            result = BLOTTO_INVALID_PLAYER;
+        }
+    }
+    stats_sample_end();
+
+    //checks if a line has more than two ids
+    if (result == BLOTTO_OK && status == MATCHUP_WRONG)
+    {
+        result = BLOTTO_WRONG_MATCHUPS;
+    }
+
+    //if fscanf doesn't reach EOF something is wrong with the format of the file
+    else if (result == BLOTTO_OK && status == MATCHUP_ISSUE)
+    {
+        result = BLOTTO_MATCHUP_ISSUE;
+    }
+
+    //if matchup file is empty
+    else if (result == BLOTTO_OK && gmap_size(point_map) == 0)
+    {
+        result = BLOTTO_EMPTY_MATCHUPS;
+    }
+
+    blotto_results *r = NULL;
+    if (result == BLOTTO_OK)
+    {
+        //bytes of a piped matchup file cannot be counted this way and are left out
+        if (ftell(matchup_file) > 0)
+        {
+            STATS_ADD(COUNTER_BYTES_READ, ftell(matchup_file));
+        }
+        STATS_ADD(COUNTER_REHASHES, gmap_rehashes(point_map));
+        stats_add_map("results", point_map);
+
+        r = results_from_map(point_map);
+        if (r == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+
+    //a finished run has nothing to resume, and a run that stopped at bad input
+    //must not be resumed past it; only a run that ran out of memory can pick up again
+    bool written = (writer != NULL && checkpointer_destroy(writer));
+    if (writer != NULL && (result == BLOTTO_OK ? written : result != BLOTTO_NO_MEMORY))
+    {
+        remove(cp->path);
+    }
+
+    pair_cache_destroy(pairs);
+    if (point_map != NULL)
+    {
+        free_fnc2(point_map);
+    }
+    free(outcomes);
+
+    set_error(error, result);
+    return r;
+}
+
+blotto_results *blotto_play_buffer(const blotto_field *f, const double *weights, const char *buffer, size_t len, blotto_error *error)
+{
+    FILE *matchups = open_buffer(buffer, len);
+    if (matchups == NULL)
+    {
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+
+    blotto_results *r = blotto_play(f, weights, matchups, error);
+    fclose(matchups);
+    return r;
+}
+
+blotto_results *blotto_play_reordered(const blotto_field *f, const double *weights, FILE *matchup_file, size_t block, blotto_error *error)
+{
+    gmap *all_players = f->players;
+    int battlefields = f->battlefields;
+    size_t num_players = gmap_size(all_players);
+
+    //a matchup_pair cannot index a field this large, and playing in the stream's order gives the same results
+    if (num_players > UINT32_MAX)
+    {
+        return blotto_play(f, weights, matchup_file, error);
+    }
+    char id1[BLOTTO_MAX_ID];
+    char id2[BLOTTO_MAX_ID];
+    matchup_status status = MATCHUP_OK;
+    size_t played = 0;
+
+    //player ids and classes in the order the field was read
+    const char **ids = malloc(sizeof(char*) * num_players);
+    size_t *player_classes = malloc(sizeof(size_t) * num_players);
+    const char **key_arr = (const char**) gmap_keys(all_players);
+
+    //the totals of each player, by index
+    double *wins = calloc(num_players, sizeof(double));
+    double *scores = calloc(num_players, sizeof(double));
+    double *games = calloc(num_players, sizeof(double));
+
+    //a block of matchups as player indices, and the outcome of the last pairing of classes scored
+    matchup_pair *pairs = malloc(sizeof(matchup_pair) * block);
+    signed char *outcomes = malloc(battlefields);
+    last_outcome last = {.valid = false};
+
+    blotto_error result = BLOTTO_OK;
+    if (ids == NULL || player_classes == NULL || key_arr == NULL || wins == NULL || scores == NULL || games == NULL || pairs == NULL || outcomes == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //check whether there is a blank space or empty line in the beginning of the file
+    else if (!matchup_file_starts_well(matchup_file))
+    {
+        result = BLOTTO_INVALID_MATCHUPS;
+    }
+
+    else
+    {
+        players_by_index(all_players, key_arr, ids, player_classes);
+    }
+    free(key_arr);
+
+    while (result == BLOTTO_OK && status == MATCHUP_OK)
+    {
+        //players are looked up as the block is read, in the order of the file
+        stats_switch(PHASE_PARSE_MATCHUPS);
+        size_t n = 0;
+        while (n < block && (status = read_matchup(matchup_file, id1, id2)) == MATCHUP_OK)
+        {
+            player *p1 = gmap_get(all_players, id1);
+            player *p2 = gmap_get(all_players, id2);
+            STATS_ADD(COUNTER_MATCHUPS, 1);
+            STATS_ADD(COUNTER_LOOKUPS, 2);
+            if (p1 == NULL || p2 == NULL)
+            {
+                result = BLOTTO_INVALID_PLAYER;
+                break;
+            }
+            pairs[n].first = p1->index;
+            pairs[n].second = p2->index;
+            n++;
+        }
+
+        //a block that ends in an error is not played, as there will be no results
+        if (result != BLOTTO_OK || status == MATCHUP_WRONG || status == MATCHUP_ISSUE)
+        {
+            break;
+        }
+
+        //matchups are only moved when no total can come out differently for it
+        stats_switch(PHASE_SORTING);
+        if (reorder_is_exact(weights, battlefields, played + n) && !reorder_matchups(pairs, n, num_players))
+        {
+            result = BLOTTO_NO_MEMORY;
+            break;
+        }
+
+        stats_switch(PHASE_SCORING);
+        play_pairs(f, weights, player_classes, pairs, n, wins, scores, games, outcomes, &last);
+        played += n;
+    }
+
+    //checks if a line has more than two ids
+    if (result == BLOTTO_OK && status == MATCHUP_WRONG)
+    {
+        result = BLOTTO_WRONG_MATCHUPS;
+    }
+
+    //if fscanf doesn't reach EOF something is wrong with the format of the file
+    else if (result == BLOTTO_OK && status == MATCHUP_ISSUE)
+    {
+        result = BLOTTO_MATCHUP_ISSUE;
+    }
+
+    //if matchup file is empty
+    else if (result == BLOTTO_OK && played == 0)
+    {
+        result = BLOTTO_EMPTY_MATCHUPS;
+    }
+
+    blotto_results *r = NULL;
+    if (result == BLOTTO_OK)
+    {
+        //bytes of a piped matchup file cannot be counted this way and are left out
+        if (ftell(matchup_file) > 0)
+        {
+            STATS_ADD(COUNTER_BYTES_READ, ftell(matchup_file));
+        }
+
+        r = results_from_totals(ids, num_players, wins, scores, games, 1, 0);
+        if (r == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+
+    free(ids);
+    free(player_classes);
+    free(wins);
+    free(scores);
+    free(games);
+    free(pairs);
+    free(outcomes);
+
+    set_error(error, result);
+    return r;
+}
+
+blotto_results *blotto_play_schedule(const blotto_field *f, const double *weights, const blotto_schedule *plan, blotto_error *error)
+{
+    gmap *all_players = f->players;
+    size_t num_players = gmap_size(all_players);
+    size_t played = 0;
+
+    //the kinds of schedule are listed in the same order
+    schedule_kind kind = (plan->kind == BLOTTO_SCHEDULE_SWISS ? SCHEDULE_SWISS : plan->kind == BLOTTO_SCHEDULE_RANDOM ? SCHEDULE_RANDOM : SCHEDULE_ROUND_ROBIN);
+    if (!schedule_fits(kind, num_players, plan->size))
+    {
+        set_error(error, BLOTTO_INVALID_SCHEDULE);
+        return NULL;
+    }
+
+    //player ids and classes in the order the field was read
+    const char **ids = malloc(sizeof(char*) * num_players);
+    size_t *player_classes = malloc(sizeof(size_t) * num_players);
+    const char **key_arr = (const char**) gmap_keys(all_players);
+
+    //the totals of each player, by index, which a Swiss schedule pairs each round from
+    double *wins = calloc(num_players, sizeof(double));
+    double *scores = calloc(num_players, sizeof(double));
+    double *games = calloc(num_players, sizeof(double));
+
+    matchup_pair *pairs = malloc(sizeof(matchup_pair) * SCHEDULE_BLOCK);
+    signed char *outcomes = malloc(f->battlefields);
+    last_outcome last = {.valid = false};
+    schedule *s = schedule_create(kind, num_players, plan->size, plan->seed);
+
+    blotto_error result = BLOTTO_OK;
+    if (ids == NULL || player_classes == NULL || key_arr == NULL || wins == NULL || scores == NULL || games == NULL || pairs == NULL || outcomes == NULL || s == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    else
+    {
+        players_by_index(all_players, key_arr, ids, player_classes);
+    }
+    free(key_arr);
+
+    //matchups are made as they are played rather than read from a file
+    size_t n;
+    while (result == BLOTTO_OK && (n = schedule_next(s, pairs, SCHEDULE_BLOCK, wins, scores)) > 0)
+    {
+        STATS_ADD(COUNTER_MATCHUPS, n);
+        stats_switch(PHASE_SCORING);
+        play_pairs(f, weights, player_classes, pairs, n, wins, scores, games, outcomes, &last);
+        played += n;
+    }
+
+    //a schedule of a single player has no matchups
+    if (result == BLOTTO_OK && played == 0)
+    {
+        result = BLOTTO_EMPTY_MATCHUPS;
+    }
+
+    blotto_results *r = NULL;
+    if (result == BLOTTO_OK)
+    {
+        r = results_from_totals(ids, num_players, wins, scores, games, 1, 0);
+        if (r == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+
+    if (s != NULL)
+    {
+        schedule_destroy(s);
+    }
+    free(ids);
+    free(player_classes);
+    free(wins);
+    free(scores);
+    free(games);
+    free(pairs);
+    free(outcomes);
+
+    set_error(error, result);
+    return r;
+}
+
+blotto_error blotto_play_weightings(const blotto_field *f, const double *weights, size_t k, FILE *matchup_file, blotto_results **results)
+{
+    gmap *all_players = f->players;
+    int battlefields = f->battlefields;
+    size_t num_players = gmap_size(all_players);
+    char id1[BLOTTO_MAX_ID];
+    char id2[BLOTTO_MAX_ID];
+    matchup_status status = MATCHUP_END;
+    size_t played = 0;
+
+    //the weights are transposed so that the k weights of each battlefield are adjacent
+    double *by_battlefield = malloc(sizeof(double) * battlefields * k);
+
+    //the totals of the player at index i under weighting j are at i * k + j
+    double *wins = calloc(num_players * k, sizeof(double));
+    double *scores = calloc(num_players * k, sizeof(double));
+    double *games = calloc(num_players, sizeof(double));
+
+    //the k scores of each class of recent pairings followed by the k wins of the lower class
+    pair_cache *pairs = pair_cache_create(sizeof(double) * 3 * k);
+    bool hit;
+    signed char *outcomes = malloc(battlefields);
+    double *swapped = malloc(sizeof(double) * 3 * k);
+
+    blotto_error result = BLOTTO_OK;
+    if (by_battlefield == NULL || wins == NULL || scores == NULL || games == NULL || pairs == NULL || outcomes == NULL || swapped == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //check whether there is a blank space or empty line in the beginning of the file
+    else if (!matchup_file_starts_well(matchup_file))
+    {
+        result = BLOTTO_INVALID_MATCHUPS;
+    }
+
+    else
+    {
+        for (size_t j = 0; j < k; j++)
+        {
+            for (int i = 0; i < battlefields; i++)
+            {
+                by_battlefield[(size_t) i * k + j] = weights[j * battlefields + i];
+            }
+        }
+    }
+
+    stats_switch(PHASE_PARSE_MATCHUPS);
+    stats_sample_begin();
+    while (result == BLOTTO_OK && (status = read_matchup(matchup_file, id1, id2)) == MATCHUP_OK)
+    {
+        stats_sample_tick();
+        stats_switch(PHASE_LOOKUPS);
+        STATS_ADD(COUNTER_MATCHUPS, 1);
+        player *p1 = gmap_get(all_players, id1);
+        player *p2 = gmap_get(all_players, id2);
+        STATS_ADD(COUNTER_LOOKUPS, 2);
+        if (p1 == NULL || p2 == NULL)
+        {
+            result = BLOTTO_INVALID_PLAYER;
+            break;
+        }
+
+        //the outcomes of a pairing are compared once and applied to every weighting
+        stats_switch(PHASE_SCORING);
+        size_t low = (p1->cls < p2->cls ? p1->cls : p2->cls);
+        size_t high = (p1->cls < p2->cls ? p2->cls : p1->cls);
+        double *outcome = pair_cache_slot(pairs, low, high, &hit);
+
+        if (hit)
+        {
+            STATS_ADD(COUNTER_CACHE_HITS, 1);
+        }
+
+        else
+        {
+            STATS_ADD(COUNTER_CACHE_MISSES, 1);
+            dist_table_compare(f->classes, low, high, outcomes);
+            score_matchup_weightings(outcomes, battlefields, by_battlefield, k, outcome, outcome + k, outcome + 2 * k);
+        }
+
+        //the cached outcome is stored lower class first
+        const double *score1 = outcome;
+        const double *score2 = outcome + k;
+        const double *wins1 = outcome + 2 * k;
+        if (p1->cls > p2->cls)
+        {
+            score1 = outcome + k;
+            score2 = outcome;
+            for (size_t j = 0; j < k; j++)
+            {
+                swapped[2 * k + j] = 1 - outcome[2 * k + j];
+            }
+            wins1 = swapped + 2 * k;
+        }
+
+        //a player facing itself shares one running score, so both sides get the whole total
+        if (p1 == p2)
+        {
+            for (size_t j = 0; j < k; j++)
+            {
+                swapped[j] = score_self_matchup(weights + j * battlefields, battlefields);
+            }
+            score1 = swapped;
+            score2 = swapped;
+        }
+
+        //the totals are added to in the same order as blotto_play adds to them
+        double *wins_of1 = wins + p1->index * k;
+        double *wins_of2 = wins + p2->index * k;
+        double *scores_of1 = scores + p1->index * k;
+        double *scores_of2 = scores + p2->index * k;
+        for (size_t j = 0; j < k; j++)
+        {
+            scores_of1[j] += score1[j];
+        }
+        for (size_t j = 0; j < k; j++)
+        {
+            scores_of2[j] += score2[j];
+        }
+        for (size_t j = 0; j < k; j++)
+        {
+            wins_of1[j] += wins1[j];
+        }
+        for (size_t j = 0; j < k; j++)
+        {
+            wins_of2[j] += 1 - wins1[j];
+        }
+        games[p1->index]++;
+        games[p2->index]++;
+        played++;
+
+        stats_switch(PHASE_PARSE_MATCHUPS);
+    }
+    stats_sample_end();
+
+    //checks if a line has more than two ids
+    if (result == BLOTTO_OK && status == MATCHUP_WRONG)
+    {
+        result = BLOTTO_WRONG_MATCHUPS;
+    }
+
+    //if fscanf doesn't reach EOF something is wrong with the format of the file
+    else if (result == BLOTTO_OK && status == MATCHUP_ISSUE)
+    {
+        result = BLOTTO_MATCHUP_ISSUE;
+    }
+
+    //if matchup file is empty
+    else if (result == BLOTTO_OK && played == 0)
+    {
+        result = BLOTTO_EMPTY_MATCHUPS;
+    }
+
+    //player ids in the order the field was read
+    const char **ids = NULL;
+    const char **key_arr = NULL;
+    if (result == BLOTTO_OK)
+    {
+        ids = malloc(sizeof(char*) * num_players);
+        key_arr = (const char**) gmap_keys(all_players);
+        if (ids == NULL || key_arr == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+    for (size_t i = 0; result == BLOTTO_OK && i < num_players; i++)
+    {
+        ids[((player*) gmap_get(all_players, key_arr[i]))->index] = key_arr[i];
+    }
+    free(key_arr);
+
+    //one set of results per weighting, of the players that played at least once
+    size_t made = 0;
+    while (result == BLOTTO_OK && made < k)
+    {
+        results[made] = results_from_totals(ids, num_players, wins, scores, games, k, made);
+        if (results[made] == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            made++;
+        }
+    }
+    if (result != BLOTTO_OK)
+    {
+        while (made > 0)
+        {
+            blotto_results_destroy(results[--made]);
+        }
+    }
+
+    if (result == BLOTTO_OK)
+    {
+        //bytes of a piped matchup file cannot be counted this way and are left out
+        if (ftell(matchup_file) > 0)
+        {
+            STATS_ADD(COUNTER_BYTES_READ, ftell(matchup_file));
+        }
+    }
+
+    pair_cache_destroy(pairs);
+    free(ids);
+    free(by_battlefield);
+    free(wins);
+    free(scores);
+    free(games);
+    free(outcomes);
+    free(swapped);
+
+    return result;
+}
+
+blotto_results *blotto_estimate(const blotto_field *f, const double *weights, const blotto_sampling *plan, int threads, blotto_error *error)
+{
+    gmap *all_players = f->players;
+    size_t num_players = gmap_size(all_players);
+    if (plan->initial == 0 || plan->limit < plan->initial || !(plan->precision >= 0))
+    {
+        set_error(error, BLOTTO_INVALID_SAMPLING);
+        return NULL;
+    }
+
+    //player ids and classes in the order the field was read
+    const char **ids = malloc(sizeof(char*) * num_players);
+    size_t *player_classes = malloc(sizeof(size_t) * num_players);
+    const char **key_arr = (const char**) gmap_keys(all_players);
+    estimate_result *estimates = malloc(sizeof(estimate_result) * (dist_table_size(f->classes) + 1));
+    blotto_results *r = malloc(sizeof(blotto_results));
+    blotto_standing *standings = malloc(sizeof(blotto_standing) * (num_players > 0 ? num_players : 1));
+
+    blotto_error result = BLOTTO_OK;
+    if (ids == NULL || player_classes == NULL || key_arr == NULL || estimates == NULL || r == NULL || standings == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    else
+    {
+        players_by_index(all_players, key_arr, ids, player_classes);
+        estimate_plan sampling = {plan->initial, plan->limit, plan->precision, plan->order == BLOTTO_BY_SCORE, plan->seed};
+        stats_switch(PHASE_SCORING);
+        if (!estimate_field(f->classes, weights, player_classes, num_players, &sampling, threads, estimates))
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+
+    //every player gets the estimate of its distribution
+    if (result == BLOTTO_OK)
+    {
+        r->standings = standings;
+        r->size = 0;
+        for (size_t i = 0; i < num_players; i++)
+        {
+            const estimate_result *e = &estimates[player_classes[i]];
+            blotto_standing *dest = &r->standings[r->size];
+            dest->id = malloc(strlen(ids[i]) + 1);
+            if (dest->id == NULL)
+            {
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+            strcpy(dest->id, ids[i]);
+            dest->wins = e->wins;
+            dest->overall_score = e->overall_score;
+            dest->games = e->games;
+            dest->wins_margin = e->wins_margin;
+            dest->score_margin = e->score_margin;
+            r->size++;
+            STATS_ADD(COUNTER_MATCHUPS, e->games);
+        }
+
+        if (result != BLOTTO_OK)
+        {
+            blotto_results_destroy(r);
+        }
+    }
+
+    else
+    {
+        free(r);
+        free(standings);
+    }
+
+    free(ids);
+    free(player_classes);
+    free(key_arr);
+    free(estimates);
+
+    set_error(error, result);
+    return (result == BLOTTO_OK ? r : NULL);
+}
+
+blotto_results *blotto_optimize(const blotto_field *f, const double *weights, const blotto_search *plan, int threads, blotto_error *error)
+{
+    int battlefields = f->battlefields;
+    if (plan->units <= 0 || !(plan->seconds > 0) || plan->keep == 0)
+    {
+        set_error(error, BLOTTO_INVALID_SEARCH);
+        return NULL;
+    }
+
+    int *best = malloc(sizeof(int) * battlefields * plan->keep);
+    int **candidates = malloc(sizeof(int*) * plan->keep);
+    query_result *scores = malloc(sizeof(query_result) * plan->keep);
+    blotto_results *r = malloc(sizeof(blotto_results));
+    blotto_standing *standings = malloc(sizeof(blotto_standing) * plan->keep);
+    size_t found = 0;
+
+    blotto_error result = BLOTTO_OK;
+    if (best == NULL || candidates == NULL || scores == NULL || r == NULL || standings == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //the distributions found are scored again as candidates, so they are reported as --query reports them
+    else
+    {
+        optimize_plan search = {plan->units, plan->seconds, plan->keep, plan->order == BLOTTO_BY_SCORE, plan->seed};
+        for (size_t i = 0; i < plan->keep; i++)
+        {
+            candidates[i] = best + i * battlefields;
+        }
+
+        stats_switch(PHASE_SCORING);
+        if (!optimize_field(f->classes, weights, &search, threads, best, &found) || !query_field(f->classes, weights, candidates, found, threads, scores))
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+        else if (found > 0)
+        {
+            STATS_ADD(COUNTER_MATCHUPS, found * scores[0].games);
+        }
+    }
+
+    //each distribution is named by its values
+    if (result == BLOTTO_OK)
+    {
+        r->standings = standings;
+        r->size = 0;
+        for (size_t i = 0; i < found; i++)
+        {
+            blotto_standing *dest = &r->standings[r->size];
+            dest->id = malloc(12 * battlefields + 1);
+            if (dest->id == NULL)
+            {
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+
+            int used = 0;
+            for (int j = 0; j < battlefields; j++)
+            {
+                used += sprintf(dest->id + used, (j == 0 ? "%d" : ",%d"), candidates[i][j]);
+            }
+            dest->wins = scores[i].wins;
+            dest->overall_score = scores[i].overall_score;
+            dest->games = scores[i].games;
+            dest->wins_margin = 0.0;
+            dest->score_margin = 0.0;
+            r->size++;
+        }
+
+        if (result != BLOTTO_OK)
+        {
+            blotto_results_destroy(r);
+        }
+    }
+
+    else
+    {
+        free(r);
+        free(standings);
+    }
+
+    free(best);
+    free(candidates);
+    free(scores);
+
+    set_error(error, result);
+    return (result == BLOTTO_OK ? r : NULL);
+}
+
+blotto_error blotto_export_matrix(const blotto_field *f, const double *weights, const char *path, int score_bits, int threads)
+{
+    gmap *all_players = f->players;
+    size_t num_players = gmap_size(all_players);
+    if (score_bits != 0 && score_bits != 8 && score_bits != 16)
+    {
+        return BLOTTO_INVALID_MATRIX;
+    }
+
+    //player ids and classes in the order the field was read, which is the order of the rows
+    const char **ids = malloc(sizeof(char*) * num_players);
+    size_t *player_classes = malloc(sizeof(size_t) * num_players);
+    const char **key_arr = (const char**) gmap_keys(all_players);
+
+    blotto_error result = BLOTTO_OK;
+    if (ids == NULL || player_classes == NULL || key_arr == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    else
+    {
+        players_by_index(all_players, key_arr, ids, player_classes);
+        stats_switch(PHASE_SCORING);
+        STATS_ADD(COUNTER_MATCHUPS, num_players * num_players);
+
+        matrix_status status = matrix_export(path, f->classes, weights, ids, player_classes, num_players, score_bits, threads);
+        if (status == MATRIX_NO_MEMORY)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+
+        else if (status == MATRIX_WRITE_ERROR)
+        {
+            result = BLOTTO_WRITE_FAILED;
+        }
+    }
+
+    free(ids);
+    free(player_classes);
+    free(key_arr);
+
+    return result;
+}
+
+blotto_results *blotto_play_updates(blotto_field *f, const double *weights, FILE *matchup_file, FILE *update_file, blotto_error *error)
+{
+    gmap *all_players = f->players;
+    char id1[BLOTTO_MAX_ID];
+    char id2[BLOTTO_MAX_ID];
+    matchup_status status = MATCHUP_END;
+
+    //player indices and classes in the order the field was read
+    size_t num_players = gmap_size(all_players);
+    const char **ids = malloc(sizeof(char*) * num_players);
+    size_t *player_classes = malloc(sizeof(size_t) * num_players);
+    const char **key_arr = (const char**) gmap_keys(all_players);
+    if (ids == NULL || player_classes == NULL || key_arr == NULL)
+    {
+        free(ids);
+        free(player_classes);
+        free(key_arr);
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+    for (size_t i = 0; i < num_players; i++)
+    {
+        player *p = gmap_get(all_players, key_arr[i]);
+        ids[p->index] = key_arr[i];
+        player_classes[p->index] = p->cls;
+    }
+    free(key_arr);
+
+    tournament *t = tournament_create(f->classes, weights, num_players, player_classes);
+    free(player_classes);
+
+    //the matchup file is checked the same way as when playing without updates
+    blotto_error result = BLOTTO_OK;
+    size_t played = 0;
+    if (t == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+    else if (!matchup_file_starts_well(matchup_file))
+    {
+        result = BLOTTO_INVALID_MATCHUPS;
+    }
+
+    //matchups are scored as they are added, so reading and scoring are charged together
+    stats_switch(PHASE_SCORING);
+    while (result == BLOTTO_OK && (status = read_matchup(matchup_file, id1, id2)) == MATCHUP_OK)
+    {
+        player *p1 = gmap_get(all_players, id1);
+        player *p2 = gmap_get(all_players, id2);
+        STATS_ADD(COUNTER_LOOKUPS, 2);
+        if (p1 == NULL || p2 == NULL)
+        {
+            result = BLOTTO_INVALID_PLAYER;
+        }
+        else if (!tournament_add_matchup(t, p1->index, p2->index))
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            STATS_ADD(COUNTER_MATCHUPS, 1);
+            played++;
+        }
+    }
+
+    if (result == BLOTTO_OK && status == MATCHUP_WRONG)
+    {
+        result = BLOTTO_WRONG_MATCHUPS;
+    }
+    else if (result == BLOTTO_OK && status == MATCHUP_ISSUE)
+    {
+        result = BLOTTO_MATCHUP_ISSUE;
+    }
+    else if (result == BLOTTO_OK && played == 0)
+    {
+        result = BLOTTO_EMPTY_MATCHUPS;
+    }
+
+    //every update is read and checked before any is applied, so a bad line leaves the field as it was
+    entry *updates = NULL;
+    size_t num_updates = 0;
+    size_t *update_classes = NULL;
+    if (result == BLOTTO_OK)
+    {
+        result = read_updates(f, update_file, &updates, &num_updates);
+    }
+    if (result == BLOTTO_OK && (update_classes = malloc(sizeof(size_t) * (num_updates > 0 ? num_updates : 1))) == NULL)
+    {
+        result = BLOTTO_NO_MEMORY;
+    }
+
+    //the classes are all made before any player moves, so running out of memory leaves the field as it was too
+    size_t interned = 0;
+    while (result == BLOTTO_OK && interned < num_updates)
+    {
+        update_classes[interned] = dist_table_intern(f->classes, updates[interned].distribution);
+        if (update_classes[interned] == DIST_TABLE_ERROR)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            interned++;
+        }
+    }
+    for (size_t i = 0; result != BLOTTO_OK && i < interned; i++)
+    {
+        dist_table_release(f->classes, update_classes[i]);
+    }
+
+    //players only need to be rescored against the matchups they are in
+    for (size_t i = 0; result == BLOTTO_OK && i < num_updates; i++)
+    {
+        player *p = gmap_get(all_players, updates[i].id);
+        dist_table_release(f->classes, p->cls);
+        p->cls = update_classes[i];
+        tournament_update(t, p->index, p->cls);
+    }
+
+    for (size_t i = 0; i < num_updates; i++)
+    {
+        entry_destroy(&updates[i]);
+    }
+    free(updates);
+    free(update_classes);
+
+    //the players that played at least once have results
+    blotto_results *r = NULL;
+    if (result == BLOTTO_OK)
+    {
+        r = malloc(sizeof(blotto_results));
+        blotto_standing *standings = malloc(sizeof(blotto_standing) * num_players);
+        if (r == NULL || standings == NULL)
+        {
+            free(r);
+            free(standings);
+            r = NULL;
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            r->standings = standings;
+            r->size = 0;
+        }
+    }
+    for (size_t i = 0; r != NULL && i < num_players; i++)
+    {
+        const standing *s = tournament_standing(t, i);
+        if (s->games > 0)
+        {
+            blotto_standing *dest = &r->standings[r->size];
+            dest->id = malloc(strlen(ids[i]) + 1);
+            if (dest->id == NULL)
+            {
+                blotto_results_destroy(r);
+                r = NULL;
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+            strcpy(dest->id, ids[i]);
+            dest->wins = s->wins;
+            dest->overall_score = s->overall_score;
+            dest->games = s->games;
+            dest->wins_margin = 0.0;
+            dest->score_margin = 0.0;
+            r->size++;
+        }
+    }
+
+    free(ids);
+    if (t != NULL)
+    {
+        tournament_destroy(t);
+    }
+
+    set_error(error, result);
+    return r;
+}
+
+blotto_results *blotto_query(const blotto_field *f, const double *weights, FILE *candidate_file, int threads, blotto_error *error)
+{
+    int battlefields = f->battlefields;
+
+    //candidates are kept in input order; ids may repeat since each is its own what-if
+    size_t n = 0;
+    size_t capacity = 64;
+    blotto_standing *standings = malloc(sizeof(blotto_standing) * capacity);
+    int **candidates = malloc(sizeof(int*) * capacity);
+    blotto_error result = (standings == NULL || candidates == NULL ? BLOTTO_NO_MEMORY : BLOTTO_OK);
+
+    entry candidate;
+    candidate.id = "";
+    while (result == BLOTTO_OK && (candidate = entry_read(candidate_file, BLOTTO_MAX_ID, battlefields)).id != NULL && strcmp(candidate.id, "") != 0)
+    {
+        if (n == capacity)
+        {
+            capacity *= 2;
+            blotto_standing *more_standings = realloc(standings, sizeof(blotto_standing) * capacity);
+            if (more_standings != NULL)
+            {
+                standings = more_standings;
+            }
+            int **more_candidates = realloc(candidates, sizeof(int*) * capacity);
+            if (more_candidates != NULL)
+            {
+                candidates = more_candidates;
+            }
+            if (more_standings == NULL || more_candidates == NULL)
+            {
+                entry_destroy(&candidate);
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+        }
+
+        standings[n].id = candidate.id;
+        candidates[n] = candidate.distribution;
+        n++;
+    }
+
+    //a NULL id means a line was not a valid distribution
+    if (result == BLOTTO_OK && candidate.id == NULL)
+    {
+        result = BLOTTO_INVALID_CANDIDATE;
+    }
+    else if (result == BLOTTO_OK)
+    {
+        free(candidate.id);
+        if (n == 0)
+        {
+            result = BLOTTO_EMPTY_CANDIDATES;
+        }
+    }
+
+    query_result *scores = malloc(sizeof(query_result) * (n > 0 ? n : 1));
+    if (result == BLOTTO_OK)
+    {
+        stats_switch(PHASE_SCORING);
+        if (scores == NULL || !query_field(f->classes, weights, candidates, n, threads, scores))
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+        else
+        {
+            STATS_ADD(COUNTER_MATCHUPS, n * scores[0].games);
+        }
+    }
+
+    blotto_results *r = NULL;
+    if (result == BLOTTO_OK)
+    {
+        r = malloc(sizeof(blotto_results));
+        if (r == NULL)
+        {
+            result = BLOTTO_NO_MEMORY;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        free(candidates[i]);
+    }
+    free(candidates);
+
+    if (r != NULL)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            standings[i].wins = scores[i].wins;
+            standings[i].overall_score = scores[i].overall_score;
+            standings[i].games = scores[i].games;
+            standings[i].wins_margin = 0.0;
+            standings[i].score_margin = 0.0;
+        }
+        r->standings = standings;
+        r->size = n;
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            free(standings[i].id);
+        }
+        free(standings);
+    }
+    free(scores);
+
+    set_error(error, result);
+    return r;
+}
+
+blotto_results *blotto_query_buffer(const blotto_field *f, const double *weights, const char *buffer, size_t len, int threads, blotto_error *error)
+{
+    FILE *candidates = open_buffer(buffer, len);
+    if (candidates == NULL)
+    {
+        set_error(error, BLOTTO_NO_MEMORY);
+        return NULL;
+    }
+
+    blotto_results *r = blotto_query(f, weights, candidates, threads, error);
+    fclose(candidates);
+    return r;
+}
+
+size_t blotto_results_size(const blotto_results *r)
+{
+    return r->size;
+}
+
+const blotto_standing *blotto_results_get(const blotto_results *r, size_t i)
+{
+    return &r->standings[i];
+}
+
+void blotto_results_sort(blotto_results *r, blotto_order order)
+{
+    qsort(r->standings, r->size, sizeof(blotto_standing), (order == BLOTTO_BY_WINS ? cmpfunc_win : cmpfunc_score));
+}
+
+void blotto_results_destroy(blotto_results *r)
+{
+    for (size_t i = 0; i < r->size; i++)
+    {
+        free(r->standings[i].id);
+    }
+    free(r->standings);
+    free(r);
+}
+
+matchup_status read_matchup(FILE* matchup_file, char *id1, char *id2)
+{
+    int num = fscanf(matchup_file, "%s %s", id1, id2);
+    if (num == 2)
+    {
+        //the two ids must be followed by the end of the line
+        int ch = fgetc(matchup_file);
+        return (ch == '\n' || ch == EOF ? MATCHUP_OK : MATCHUP_WRONG);
+    }
+
+    //if num doesn't return -1 (EOF) something is wrong with the format of the file
+    return (num == -1 ? MATCHUP_END : MATCHUP_ISSUE);
+}
+
+bool matchup_file_starts_well(FILE *matchup_file)
+{
+    int ch = fgetc(matchup_file);
+    if (ch == ' ' || ch == '\n')
+    {
+        return false;
+    }
+
+    ungetc(ch, matchup_file);
+    return true;
+}
+
+blotto_results *results_from_map(gmap *point_map)
+{
+    //the standings are moved out of the map, which keeps only its keys
+    size_t n = gmap_size(point_map);
+    blotto_results *r = malloc(sizeof(blotto_results));
+    blotto_standing *standings = malloc(sizeof(blotto_standing) * (n > 0 ? n : 1));
+    if (r == NULL || standings == NULL)
+    {
+        free(r);
+        free(standings);
+        return NULL;
+    }
+
+    r->standings = standings;
+    r->size = 0;
+    gmap_for_each(point_map, move_standing, r);
+    return r;
+}
+
+blotto_results *results_from_totals(const char **ids, size_t n, const double *wins, const double *scores, const double *games, size_t k, size_t j)
+{
+    blotto_results *r = malloc(sizeof(blotto_results));
+    blotto_standing *standings = malloc(sizeof(blotto_standing) * (n > 0 ? n : 1));
+    if (r == NULL || standings == NULL)
+    {
+        free(r);
+        free(standings);
+        return NULL;
+    }
+    r->standings = standings;
+    r->size = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (games[i] > 0)
+        {
+            blotto_standing *dest = &r->standings[r->size];
+            dest->id = malloc(strlen(ids[i]) + 1);
+            if (dest->id == NULL)
+            {
+                blotto_results_destroy(r);
+                return NULL;
+            }
+            strcpy(dest->id, ids[i]);
+            dest->wins = wins[i * k + j];
+            dest->overall_score = scores[i * k + j];
+            dest->games = games[i];
+            dest->wins_margin = 0.0;
+            dest->score_margin = 0.0;
+            r->size++;
+        }
+    }
+
+    return r;
+}
+
+void play_pairs(const blotto_field *f, const double *weights, const size_t *player_classes, const matchup_pair *pairs, size_t n,
+                double *wins, double *scores, double *games, signed char *outcomes, last_outcome *last)
+{
+    int battlefields = f->battlefields;
+    pair_outcome swapped;
+    double half;
+    bool uniform = uniform_weights(weights, battlefields, &half);
+    double self_score = score_self_matchup(weights, battlefields);
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t index1 = pairs[i].first;
+        size_t index2 = pairs[i].second;
+        size_t cls1 = player_classes[index1];
+        size_t cls2 = player_classes[index2];
+        size_t low = (cls1 < cls2 ? cls1 : cls2);
+        size_t high = (cls1 < cls2 ? cls2 : cls1);
+
+        //the outcome of the last pairing is kept for when the next matchup repeats it
+        if (last->valid && low == last->low && high == last->high)
+        {
+            STATS_ADD(COUNTER_CACHE_HITS, 1);
+        }
+        else
+        {
+            STATS_ADD(COUNTER_CACHE_MISSES, 1);
+            if (uniform)
+            {
+                dist_table_score_uniform(f->classes, low, high, half, &last->outcome);
+            }
+            else
+            {
+                dist_table_compare(f->classes, low, high, outcomes);
+                score_matchup(outcomes, battlefields, weights, &last->outcome);
+            }
+            last->low = low;
+            last->high = high;
+            last->valid = true;
+        }
+
+        //the outcome is stored lower class first
+        const pair_outcome *outcome = &last->outcome;
+        if (cls1 > cls2)
+        {
+            swapped.score1 = last->outcome.score2;
+            swapped.score2 = last->outcome.score1;
+            swapped.wins1 = 1 - last->outcome.wins1;
+            outcome = &swapped;
+        }
+
+        //a player facing itself shares one running score, so both sides get the whole total
+        if (index1 == index2)
+        {
+            swapped.score1 = self_score;
+            swapped.score2 = self_score;
+            swapped.wins1 = outcome->wins1;
+            outcome = &swapped;
+        }
+
+        //the totals are added to in the same order as blotto_play adds to them
+        scores[index1] += outcome->score1;
+        scores[index2] += outcome->score2;
+        wins[index1] += outcome->wins1;
+        wins[index2] += 1 - outcome->wins1;
+        games[index1]++;
+        games[index2]++;
+    }
+}
+
+pair_cache *pair_cache_create(size_t size)
+{
+    pair_cache *c = malloc(sizeof(pair_cache));
+    if (c == NULL)
+    {
+        return NULL;
+    }
+
+    //as many slots as fit in the budget, rounded down to a power of two
+    size_t slots = PAIR_CACHE_SLOTS;
+    while (slots > 1 && slots * size > PAIR_CACHE_BYTES)
+    {
+        slots /= 2;
+    }
+
+    c->lows = malloc(sizeof(size_t) * slots);
+    c->highs = malloc(sizeof(size_t) * slots);
+    c->values = malloc(size * slots);
+    c->mask = slots - 1;
+    c->size = size;
+    if (c->lows == NULL || c->highs == NULL || c->values == NULL)
+    {
+        pair_cache_destroy(c);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < slots; i++)
+    {
+        c->lows[i] = SIZE_MAX;
+    }
+    return c;
+}
+
+void *pair_cache_slot(pair_cache *c, size_t low, size_t high, bool *hit)
+{
+    uint64_t mix = (uint64_t) low * 0x9E3779B97F4A7C15ULL ^ (uint64_t) high * 0xC2B2AE3D27D4EB4FULL;
+    size_t i = (size_t) (mix ^ (mix >> 32)) & c->mask;
+
+    *hit = (c->lows[i] == low && c->highs[i] == high);
+    c->lows[i] = low;
+    c->highs[i] = high;
+    return c->values + i * c->size;
+}
+
+void pair_cache_destroy(pair_cache *c)
+{
+    if (c != NULL)
+    {
+        free(c->lows);
+        free(c->highs);
+        free(c->values);
+        free(c);
+    }
+}
+
+void players_by_index(gmap *all_players, const char **key_arr, const char **ids, size_t *player_classes)
+{
+    size_t num_players = gmap_size(all_players);
+    for (size_t i = 0; i < num_players; i++)
+    {
+        player *p = gmap_get(all_players, key_arr[i]);
+        ids[p->index] = key_arr[i];
+        player_classes[p->index] = p->cls;
+    }
+}
+
+void move_standing(const void *key, void *value, void *arg)
+{
+    blotto_results *r = arg;
+    blotto_standing *s = value;
+    r->standings[r->size++] = *s;
+    s->id = NULL;
+}
+
+bool restore_standing(const char *id, double wins, double overall_score, double games, void *arg)
+{
+    restore_arg *restore = arg;
+    if (strlen(id) >= BLOTTO_MAX_ID || !gmap_contains_key(restore->all_players, id))
+    {
+        return false;
+    }
+
+    //a player may only appear once in a snapshot
+    bool added;
+    blotto_standing *stats = gmap_upsert(restore->point_map, id, &added);
+    if (stats == NULL || !added || (stats->id = malloc(sizeof(char) * BLOTTO_MAX_ID)) == NULL)
+    {
+        return false;
+    }
+
+    strcpy(stats->id, id);
+    stats->wins = wins;
+    stats->overall_score = overall_score;
+    stats->games = games;
+    return true;
+}
+
+blotto_error read_updates(const blotto_field *f, FILE *update_file, entry **updates, size_t *count)
+{
+    size_t capacity = 16;
+    *updates = malloc(sizeof(entry) * capacity);
+    *count = 0;
+    blotto_error result = (*updates == NULL ? BLOTTO_NO_MEMORY : BLOTTO_OK);
+
+    entry line;
+    line.id = "";
+    while (result == BLOTTO_OK && (line = entry_read(update_file, BLOTTO_MAX_ID, f->battlefields)).id != NULL && strcmp(line.id, "") != 0)
+    {
+        if (gmap_get(f->players, line.id) == NULL)
+        {
+            entry_destroy(&line);
+            result = BLOTTO_INVALID_UPDATE;
+            break;
+        }
+
+        if (*count == capacity)
+        {
+            entry *more = realloc(*updates, sizeof(entry) * capacity * 2);
+            if (more == NULL)
+            {
+                entry_destroy(&line);
+                result = BLOTTO_NO_MEMORY;
+                break;
+            }
+            *updates = more;
+            capacity *= 2;
+        }
+
+        (*updates)[(*count)++] = line;
+    }
+
+    //a NULL id means a line was not a valid distribution
+    if (result == BLOTTO_OK && line.id == NULL)
+    {
+        result = BLOTTO_INVALID_UPDATE;
+    }
+    else if (result == BLOTTO_OK)
+    {
+        free(line.id);
+    }
+
+    return result;
+}
+
+checkpoint *snapshot_results(gmap *point_map, long offset, const checkpoint_source *source, int battlefields, const double *weights, size_t field_size)
+{
+    //a piped matchup file cannot be resumed, so there is no point saving it
+    if (offset < 0 || source == NULL)
+    {
+        return NULL;
+    }
+
+    //the ids are the standings' own, which are freed only after the writer is done with them
+    checkpoint *c = checkpoint_create(offset, source, battlefields, weights, field_size);
+    if (c != NULL)
+    {
+        gmap_for_each(point_map, snapshot_standing, &c);
+    }
+
+    return c;
+}
+
+void snapshot_standing(const void *key, void *value, void *arg)
+{
+    //a snapshot that could not take a player is dropped
+    checkpoint **c = arg;
+    blotto_standing *s = value;
+    if (*c != NULL && !checkpoint_add(*c, s->id, s->wins, s->overall_score, s->games))
+    {
+        checkpoint_destroy(*c);
+        *c = NULL;
+    }
+}
+
+FILE *open_buffer(const char *buffer, size_t len)
+{
+    //the stream is only read, so the buffer is not changed
+    return fmemopen((void*) buffer, len, "r");
+}
+
+void set_error(blotto_error *error, blotto_error value)
+{
+    if (error != NULL)
+    {
+        *error = value;
+    }
+}
+
+int cmpfunc_win(const void *key1, const void *key2)
+{
+    //declares const void as blotto_standing*
+    blotto_standing *r1 = (blotto_standing*)key1;
+    blotto_standing *r2 = (blotto_standing*)key2;
+
+    if ((r1->wins/r1->games) > (r2->wins/r2->games))
+    {
+        return -1;
+    }
+
+    else if ((r1->wins/r1->games) < (r2->wins/r2->games))
+    {
+        return 1;
+    }
+
+    else
+    {
+        return strcmp(r1->id, r2->id);
+    }
+}
+
+int cmpfunc_score(const void *key1, const void *key2)
+{
+    //declares const void as blotto_standing*
+    blotto_standing *r1 = (blotto_standing*)key1;
+    blotto_standing *r2 = (blotto_standing*)key2;
+
+    if ((r1->overall_score/r1->games) > (r2->overall_score/r2->games))
+    {
+        return -1;
+    }
+
+    else if ((r1->overall_score/r1->games) < (r2->overall_score/r2->games))
+    {
+        return 1;
+    }
+
+    else
+    {
+        return strcmp(r1->id, r2->id);
+    }
+}
+
+void free_fnc(gmap *all_players)
+{
+    //function for freeing first gmap
+    const char **key_arr = (const char**) gmap_keys(all_players);
+
+    for (size_t i = 0; i < gmap_size(all_players); i++)
+    {
+        free(gmap_get(all_players, key_arr[i]));
+    }
+
+    free(key_arr);
+    gmap_destroy(all_players);
+}
+
+void free_fnc2(gmap *point_map)
+{
+    //the standings are stored in the map, so only their ids need freeing
+    gmap_for_each(point_map, free_standing_id, NULL);
+    gmap_destroy(point_map);
+}
+
+void free_standing_id(const void *key, void *value, void *arg)
+{
+    free(((blotto_standing *) value)->id);
+}
@@ -0,0 +1,505 @@
+#ifndef __LIBBLOTTO_H__
+#define __LIBBLOTTO_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The most characters kept of a player's id; longer ids are truncated.
+ */
+#define BLOTTO_MAX_ID 32
+
+//what went wrong in a call, BLOTTO_OK if nothing did
+typedef enum blotto_error
+{
+    BLOTTO_OK,
+    BLOTTO_NO_MEMORY,
+    BLOTTO_INVALID_DISTRIBUTION,
+    BLOTTO_DUPLICATE_PLAYER,
+    BLOTTO_EMPTY_DISTRIBUTIONS,
+    BLOTTO_INVALID_MATCHUPS,
+    BLOTTO_INVALID_PLAYER,
+    BLOTTO_WRONG_MATCHUPS,
+    BLOTTO_MATCHUP_ISSUE,
+    BLOTTO_EMPTY_MATCHUPS,
+    BLOTTO_INVALID_CANDIDATE,
+    BLOTTO_EMPTY_CANDIDATES,
+    BLOTTO_INVALID_UPDATE,
+    BLOTTO_INVALID_CHECKPOINT,
+    BLOTTO_INVALID_SCHEDULE,
+    BLOTTO_INVALID_MATRIX,
+    BLOTTO_WRITE_FAILED,
+    BLOTTO_INVALID_SAMPLING,
+    BLOTTO_INVALID_SEARCH
+} blotto_error;
+
+//orders of results
+typedef enum blotto_order {BLOTTO_BY_WINS, BLOTTO_BY_SCORE} blotto_order;
+
+/**
+ * The results of one player or candidate
+ *
+ * @param id the player's id
+ * @param wins the wins, ties count as half a win
+ * @param overall_score the total score
+ * @param games the number of games played
+ * @param wins_margin half the width of the 95% confidence interval of the
+ * win rate when the results are estimated, 0 when they are exact
+ * @param score_margin half the width of the 95% confidence interval of the
+ * average score when the results are estimated, 0 when they are exact
+ */
+typedef struct _blotto_standing
+{
+    char *id;
+    double wins;
+    double overall_score;
+    double games;
+    double wins_margin;
+    double score_margin;
+} blotto_standing;
+
+/**
+ * How a long run of matchups saves its progress so that it can be resumed
+ *
+ * @param path the name of the file snapshots are saved to
+ * @param every the number of matchups between snapshots, positive
+ * @param resume true to start from the snapshot in the file, if there is one
+ */
+typedef struct _blotto_checkpoint
+{
+    const char *path;
+    size_t every;
+    bool resume;
+} blotto_checkpoint;
+
+//ways of making matchups up rather than reading them
+typedef enum blotto_schedule_kind {BLOTTO_SCHEDULE_SWISS, BLOTTO_SCHEDULE_RANDOM, BLOTTO_SCHEDULE_ROUND_ROBIN} blotto_schedule_kind;
+
+/**
+ * A schedule of matchups made up as they are played
+ *
+ * @param kind BLOTTO_SCHEDULE_SWISS for rounds of players with similar
+ * standings, BLOTTO_SCHEDULE_RANDOM for a number of different opponents
+ * drawn for each player, or BLOTTO_SCHEDULE_ROUND_ROBIN for random groups
+ * in which everyone meets everyone
+ * @param size the number of rounds, opponents or players in a group
+ * @param seed the seed for the random choices; the same seed gives the same schedule
+ */
+typedef struct _blotto_schedule
+{
+    blotto_schedule_kind kind;
+    size_t size;
+    uint64_t seed;
+} blotto_schedule;
+
+/**
+ * How blotto_estimate samples opponents
+ *
+ * @param initial the number of opponents first drawn for each player, positive
+ * @param limit the most opponents drawn for a player, at least initial
+ * @param precision the half-width of confidence interval to sample players
+ * near others in the ranking down to, in win rate or in average score
+ * @param order the ranking whose neighbours are told apart, and which the
+ * precision is measured in
+ * @param seed the seed for drawing opponents; the same seed gives the same estimates
+ */
+typedef struct _blotto_sampling
+{
+    size_t initial;
+    size_t limit;
+    double precision;
+    blotto_order order;
+    uint64_t seed;
+} blotto_sampling;
+
+/**
+ * How blotto_optimize searches for the best responses to the field
+ *
+ * @param units the number of units every distribution places, positive
+ * @param seconds how long to search for, positive
+ * @param keep the number of distributions to return, positive
+ * @param order BLOTTO_BY_WINS to search for the highest win rate,
+ * BLOTTO_BY_SCORE for the highest average score
+ * @param seed the seed for where the searches start
+ */
+typedef struct _blotto_search
+{
+    int units;
+    double seconds;
+    size_t keep;
+    blotto_order order;
+    uint64_t seed;
+} blotto_search;
+
+struct _blotto_field;
+typedef struct _blotto_field blotto_field;
+
+struct _blotto_results;
+typedef struct _blotto_results blotto_results;
+
+/**
+ * Returns a description of the given error, as the blotto program reports it.
+ *
+ * @param error an error code
+ * @return a string that must not be changed or freed
+ */
+const char *blotto_strerror(blotto_error error);
+
+
+/**
+ * Reads a field of players and their distributions from the given stream,
+ * one "id,units,units,..." line per player, up to the first blank line or
+ * the end of the stream.  The lines are parsed by the given number of
+ * threads.  A field can be used by any number of evaluations, and by
+ * several threads at once as long as none of them changes it.
+ *
+ * @param in a stream, non-NULL
+ * @param battlefields the number of battlefields, positive
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the field, or NULL if there was an error; it is the
+ * caller's responsibility to destroy the field
+ */
+blotto_field *blotto_field_load(FILE *in, int battlefields, int threads, blotto_error *error);
+
+
+/**
+ * Reads a field from the given buffer as blotto_field_load reads it from a
+ * stream.
+ *
+ * @param buffer a pointer to len bytes, non-NULL
+ * @param len the number of bytes in the buffer
+ * @param battlefields the number of battlefields, positive
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the field, or NULL if there was an error; it is the
+ * caller's responsibility to destroy the field
+ */
+blotto_field *blotto_field_parse(const char *buffer, size_t len, int battlefields, int threads, blotto_error *error);
+
+
+/**
+ * Makes a copy of the given field that can be changed without changing the
+ * original, for instance to update a field that other threads are using.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the copy, or NULL if there was an error; it is the
+ * caller's responsibility to destroy the copy
+ */
+blotto_field *blotto_field_copy(const blotto_field *f, blotto_error *error);
+
+
+/**
+ * Returns the number of players in the given field.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @return the number of players
+ */
+size_t blotto_field_size(const blotto_field *f);
+
+
+/**
+ * Returns the number of battlefields of the given field.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @return the number of battlefields
+ */
+int blotto_field_battlefields(const blotto_field *f);
+
+
+/**
+ * Replaces the distribution of a player in the given field.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param id a pointer to a string, non-NULL
+ * @param distribution an array of the field's battlefield count, non-NULL
+ * @return BLOTTO_OK, BLOTTO_INVALID_UPDATE if there is no such player, or
+ * BLOTTO_NO_MEMORY
+ */
+blotto_error blotto_field_update(blotto_field *f, const char *id, const int *distribution);
+
+
+/**
+ * Destroys the given field.
+ *
+ * @param f a pointer to a field, non-NULL
+ */
+void blotto_field_destroy(blotto_field *f);
+
+
+/**
+ * Plays the matchups read from the given stream, one "id1 id2" line per
+ * matchup, between players of the given field.  The field is not changed.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param matchups a stream, non-NULL
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results of every player in at least one matchup,
+ * or NULL if there was an error; it is the caller's responsibility to
+ * destroy the results
+ */
+blotto_results *blotto_play(const blotto_field *f, const double *weights, FILE *matchups, blotto_error *error);
+
+
+/**
+ * Plays the matchups read from the given stream as blotto_play does, saving
+ * the results so far and the position in the stream to a snapshot file
+ * every so many matchups.  Snapshots are laid out and written by a thread
+ * of their own and one is skipped if the last is still being written;
+ * play only stops to copy each player's results, which takes time in
+ * proportion to the players that have played.  When resuming,
+ * play starts from the snapshot if there is one, which must have been made
+ * with the same weights and field, of the same matchup file unchanged
+ * since.  The snapshot is removed when the run finishes or stops at bad
+ * input, and is kept only if it runs out of memory.  Only a stream that
+ * reads a regular file can be resumed.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param matchups a stream, non-NULL
+ * @param cp a pointer to how to save progress, or NULL to play as blotto_play
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results, or NULL if there was an error; it is
+ * the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_play_checkpointed(const blotto_field *f, const double *weights, FILE *matchups, const blotto_checkpoint *cp, blotto_error *error);
+
+
+/**
+ * Plays the matchups read from the given stream as blotto_play does, a
+ * block at a time.  The matchups in each block are sorted so that those
+ * between nearby players in the field are played together, which keeps
+ * what is read for each player in cache for large fields.  The results are
+ * the same as blotto_play's: a block is only sorted when the weights make
+ * every total exact whatever order it is added up in, which they do when
+ * each weight is a multiple of one half, and is played in the order of
+ * the stream otherwise.  A field of more than UINT32_MAX players is played
+ * as blotto_play plays it.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param matchups a stream, non-NULL
+ * @param block the number of matchups to sort at a time, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results, or NULL if there was an error; it is
+ * the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_play_reordered(const blotto_field *f, const double *weights, FILE *matchups, size_t block, blotto_error *error);
+
+
+/**
+ * Plays the matchups of the given schedule between players of the field,
+ * making them as they are played instead of reading them from a stream.
+ * Each Swiss round is paired from the standings after the rounds before
+ * it; in a Swiss round with an odd number of players one of them sits out.
+ * A random schedule needs fewer opponents than players and a round-robin
+ * schedule groups of at least two.  Only players in at least one matchup
+ * have results.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param plan a pointer to the schedule, non-NULL
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results, or NULL if there was an error, such as
+ * BLOTTO_INVALID_SCHEDULE if the schedule does not suit the size of the
+ * field; it is the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_play_schedule(const blotto_field *f, const double *weights, const blotto_schedule *plan, blotto_error *error);
+
+
+/**
+ * Plays the matchups read from the given stream as blotto_play does under
+ * each of several weightings of the battlefields, in one pass.  The
+ * battlefield outcomes of each pairing of distributions are worked out
+ * once and scored under every weighting together, and the results under
+ * each weighting are the same as blotto_play gives with those weights.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights an array of k weightings one after the other, each of the
+ * field's number of battlefields, non-NULL
+ * @param k the number of weightings, positive
+ * @param matchups a stream, non-NULL
+ * @param results an array with room for k pointers, non-NULL, which are set
+ * to the results under each weighting if there is no error; it is the
+ * caller's responsibility to destroy them
+ * @return BLOTTO_OK, or the error that stopped play
+ */
+blotto_error blotto_play_weightings(const blotto_field *f, const double *weights, size_t k, FILE *matchups, blotto_results **results);
+
+
+/**
+ * Plays the matchups in the given buffer as blotto_play plays them from a
+ * stream.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param buffer a pointer to len bytes, non-NULL
+ * @param len the number of bytes in the buffer
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results, or NULL if there was an error; it is
+ * the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_play_buffer(const blotto_field *f, const double *weights, const char *buffer, size_t len, blotto_error *error);
+
+
+/**
+ * Estimates the win rate and average score of every player of the field
+ * against the whole field, including itself, without playing every
+ * pairing.  Each player is played against opponents drawn at random from
+ * the field, players with the same distribution sharing their draws.  A
+ * player whose confidence interval overlaps that of a player next to it in
+ * the ranking the plan names is sampled more, doubling its opponents each
+ * time, until its interval is as narrow as the plan's precision or it has
+ * had the plan's limit of opponents.  The wins, overall score and games of
+ * each standing are over the opponents drawn, and the margins give the
+ * intervals.  Estimates do not depend on the number of threads.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param plan a pointer to how to sample, non-NULL
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results of every player, or NULL if there was
+ * an error, such as BLOTTO_INVALID_SAMPLING if the plan's numbers do not
+ * fit together; it is the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_estimate(const blotto_field *f, const double *weights, const blotto_sampling *plan, int threads, blotto_error *error);
+
+
+/**
+ * Searches for the distributions of the plan's units that do best against
+ * the field, for the plan's time, by local search on the given number of
+ * threads.  The distributions found are scored against the field as
+ * blotto_query scores candidates, and each standing's id is its
+ * distribution, its values separated by commas.  The search is random, so
+ * runs may find different distributions.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param plan a pointer to how to search, non-NULL
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results of the distributions found, at most the
+ * plan's number of them, or NULL if there was an error, such as
+ * BLOTTO_INVALID_SEARCH if the plan's numbers are not positive; it is the
+ * caller's responsibility to destroy the results
+ */
+blotto_results *blotto_optimize(const blotto_field *f, const double *weights, const blotto_search *plan, int threads, blotto_error *error);
+
+
+/**
+ * Writes the outcome of every pairing of players of the given field,
+ * including each player against itself, to a file as a matrix with a row
+ * and a column for each player in the order the field was read.  Each
+ * outcome takes 2 bits, and the share of the total weight the row player
+ * scores can be added quantized to 8 or 16 bits.  The file is laid out to
+ * be mapped into memory; matrix.h describes the layout.  The matrix is
+ * worked out and written a band of rows at a time by the given number of
+ * threads, so it can be larger than memory.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, all positive, non-NULL
+ * @param path the name of the file, non-NULL
+ * @param score_bits 0 for outcomes only, or 8 or 16 to add the scores
+ * @param threads the number of threads to use, positive
+ * @return BLOTTO_OK, BLOTTO_INVALID_MATRIX if the score width is not one
+ * of those, BLOTTO_WRITE_FAILED if the file could not be written, or
+ * BLOTTO_NO_MEMORY
+ */
+blotto_error blotto_export_matrix(const blotto_field *f, const double *weights, const char *path, int score_bits, int threads);
+
+
+/**
+ * Plays the matchups read from the given stream, then applies the
+ * distribution updates read from the other stream, in the same format as
+ * the field, to both the field and the results.  Only the matchups of
+ * updated players are scored again.  Every update is read and checked
+ * before any is applied, so the field is left as it was if there is an
+ * error.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param matchups a stream, non-NULL
+ * @param updates a stream, non-NULL
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results after the updates, or NULL if there was
+ * an error; it is the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_play_updates(blotto_field *f, const double *weights, FILE *matchups, FILE *updates, blotto_error *error);
+
+
+/**
+ * Scores each candidate read from the given stream, in the same format as
+ * the field, against every player of the field.  The candidates are split
+ * among the given number of threads.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param candidates a stream, non-NULL
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results of the candidates in the order they were
+ * read, or NULL if there was an error; it is the caller's responsibility to
+ * destroy the results
+ */
+blotto_results *blotto_query(const blotto_field *f, const double *weights, FILE *candidates, int threads, blotto_error *error);
+
+
+/**
+ * Scores the candidates in the given buffer as blotto_query scores them
+ * from a stream.
+ *
+ * @param f a pointer to a field, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param buffer a pointer to len bytes, non-NULL
+ * @param len the number of bytes in the buffer
+ * @param threads the number of threads to use, positive
+ * @param error a pointer to where to store the error, or NULL
+ * @return a pointer to the results, or NULL if there was an error; it is
+ * the caller's responsibility to destroy the results
+ */
+blotto_results *blotto_query_buffer(const blotto_field *f, const double *weights, const char *buffer, size_t len, int threads, blotto_error *error);
+
+
+/**
+ * Returns the number of standings in the given results.
+ *
+ * @param r a pointer to results, non-NULL
+ * @return the number of standings
+ */
+size_t blotto_results_size(const blotto_results *r);
+
+
+/**
+ * Returns the standing at the given position in the given results.
+ *
+ * @param r a pointer to results, non-NULL
+ * @param i an index less than the number of standings
+ * @return a pointer to the standing, valid until the results are sorted
+ * or destroyed
+ */
+const blotto_standing *blotto_results_get(const blotto_results *r, size_t i);
+
+
+/**
+ * Sorts the given results from best to worst by win rate or by average
+ * score, with ties broken by id.
+ *
+ * @param r a pointer to results, non-NULL
+ * @param order BLOTTO_BY_WINS or BLOTTO_BY_SCORE
+ */
+void blotto_results_sort(blotto_results *r, blotto_order order);
+
+
+/**
+ * Destroys the given results.
+ *
+ * @param r a pointer to results, non-NULL
+ */
+void blotto_results_destroy(blotto_results *r);
+
+#endif
@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+//bytes read per thread for each block of the input
+#define LOADER_BLOCK_PER_THREAD (1 << 20)
+
+//how a chunk's lines stopped
+typedef enum chunk_status {CHUNK_RAN_OUT, CHUNK_END, CHUNK_INVALID, CHUNK_NO_MEMORY} chunk_status;
+
+/**
+ * A line-aligned part of a block, parsed by one thread
+ *
+ * @param start the first byte of the chunk
+ * @param end one past the last byte of the chunk
+ * @param entries the valid entries at the start of the chunk
+ * @param size the number of entries
+ * @param capacity the room in entries
+ * @param status why parsing stopped; after CHUNK_END or CHUNK_INVALID the
+ * line that stopped it is the one after the last entry
+ * @param max_id the most characters kept of an id
+ * @param battlefields the number of battlefields in a distribution
+ */
+typedef struct _loader_chunk
+{
+    const char *start;
+    const char *end;
+    entry *entries;
+    size_t size;
+    size_t capacity;
+    chunk_status status;
+    int max_id;
+    int battlefields;
+} loader_chunk;
+
+void *loader_parse_chunk(void *arg);
+bool loader_run(loader_chunk *chunks, int n, void *(*f)(void *));
+void loader_discard(entry *entries, size_t n);
+
+//parses the lines of a chunk until it runs out or a line stops the input
+void *loader_parse_chunk(void *arg)
+{
+    loader_chunk *chunk = arg;
+    const char *pos = chunk->start;
+    chunk->status = CHUNK_RAN_OUT;
+
+    while (pos < chunk->end)
+    {
+        if (chunk->size == chunk->capacity)
+        {
+            size_t capacity = chunk->capacity == 0 ? 256 : chunk->capacity * 2;
+            entry *bigger = realloc(chunk->entries, sizeof(entry) * capacity);
+            if (bigger == NULL)
+            {
+                chunk->status = CHUNK_NO_MEMORY;
+                return NULL;
+            }
+            chunk->entries = bigger;
+            chunk->capacity = capacity;
+        }
+
+        entry line = entry_parse(&pos, chunk->end, chunk->max_id, chunk->battlefields);
+        if (line.id == NULL)
+        {
+            //entry_parse gives no id for an allocation error too, which
+            //entry_read callers also report as an invalid line
+            chunk->status = CHUNK_INVALID;
+            return NULL;
+        }
+        else if (line.id[0] == '\0')
+        {
+            free(line.id);
+            chunk->status = CHUNK_END;
+            return NULL;
+        }
+
+        chunk->entries[chunk->size++] = line;
+    }
+
+    return NULL;
+}
+
+//runs the function on each chunk, one thread per chunk
+bool loader_run(loader_chunk *chunks, int n, void *(*f)(void *))
+{
+    if (n == 1)
+    {
+        f(&chunks[0]);
+        return true;
+    }
+
+    pthread_t *ids = malloc(sizeof(pthread_t) * n);
+    if (ids == NULL)
+    {
+        return false;
+    }
+
+    int started = 0;
+    bool ok = true;
+    for (int t = 0; t < n; t++)
+    {
+        if (pthread_create(&ids[t], NULL, f, &chunks[t]) != 0)
+        {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(ids[t], NULL);
+    }
+
+    free(ids);
+    return ok;
+}
+
+void loader_discard(entry *entries, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        entry_destroy(&entries[i]);
+    }
+}
+
+loader_status loader_read(FILE *in, int max_id, int battlefields, int threads, loader_result *result)
+{
+    result->entries = NULL;
+    result->size = 0;
+    result->bytes = 0;
+
+    size_t capacity = (size_t) threads * LOADER_BLOCK_PER_THREAD;
+    char *buffer = malloc(capacity);
+    loader_chunk *chunks = calloc(threads, sizeof(loader_chunk));
+    if (buffer == NULL || chunks == NULL)
+    {
+        free(buffer);
+        free(chunks);
+        return LOADER_NO_MEMORY;
+    }
+
+    size_t room = 0;
+    size_t held = 0;
+    bool at_eof = false;
+    bool done = false;
+    loader_status status = LOADER_OK;
+    while (!done && status == LOADER_OK)
+    {
+        //fill the buffer after what was left over from the last block
+        if (!at_eof)
+        {
+            size_t got = fread(buffer + held, 1, capacity - held, in);
+            result->bytes += got;
+            held += got;
+            at_eof = (held < capacity);
+        }
+
+        //the block ends after the last newline unless the input has ended
+        size_t length = held;
+        if (!at_eof)
+        {
+            while (length > 0 && buffer[length - 1] != '\n')
+            {
+                length--;
+            }
+            if (length == 0)
+            {
+                //a line longer than the buffer; make room for more of it
+                char *bigger = realloc(buffer, capacity * 2);
+                if (bigger == NULL)
+                {
+                    status = LOADER_NO_MEMORY;
+                    break;
+                }
+                buffer = bigger;
+                capacity *= 2;
+                continue;
+            }
+        }
+
+        if (length == 0)
+        {
+            break;
+        }
+
+        //split the block into chunks that each start at the start of a line;
+        //a newline always ends a line, even one after a carriage return
+        int n = 0;
+        const char *start = buffer;
+        for (int t = 0; t < threads && start < buffer + length; t++)
+        {
+            const char *end = buffer + length * (t + 1) / threads;
+            if (end < start)
+            {
+                end = start;
+            }
+            while (end < buffer + length && end > buffer && end[-1] != '\n')
+            {
+                end++;
+            }
+            if (end == start)
+            {
+                continue;
+            }
+
+            loader_chunk *c = &chunks[n++];
+            c->start = start;
+            c->end = end;
+            c->size = 0;
+            c->max_id = max_id;
+            c->battlefields = battlefields;
+            start = end;
+        }
+
+        if (!loader_run(chunks, n, loader_parse_chunk))
+        {
+            status = LOADER_NO_MEMORY;
+        }
+
+        //keep the chunks up to the first one with a line that ends the input
+        size_t total = result->size;
+        int used = n;
+        for (int t = 0; t < n; t++)
+        {
+            total += chunks[t].size;
+            if (chunks[t].status != CHUNK_RAN_OUT)
+            {
+                used = t + 1;
+                done = true;
+                if (chunks[t].status == CHUNK_INVALID && status == LOADER_OK)
+                {
+                    status = LOADER_INVALID;
+                }
+                else if (chunks[t].status == CHUNK_NO_MEMORY)
+                {
+                    status = LOADER_NO_MEMORY;
+                }
+                break;
+            }
+        }
+
+        //move the entries to the result in the order of their lines
+        if (total > room && status != LOADER_NO_MEMORY)
+        {
+            size_t bigger_room = room == 0 ? 1024 : room;
+            while (bigger_room < total)
+            {
+                bigger_room *= 2;
+            }
+            entry *bigger = realloc(result->entries, sizeof(entry) * bigger_room);
+            if (bigger == NULL)
+            {
+                status = LOADER_NO_MEMORY;
+            }
+            else
+            {
+                result->entries = bigger;
+                room = bigger_room;
+            }
+        }
+        for (int t = 0; t < n; t++)
+        {
+            if (t < used && status != LOADER_NO_MEMORY && chunks[t].size > 0)
+            {
+                memcpy(result->entries + result->size, chunks[t].entries, sizeof(entry) * chunks[t].size);
+                result->size += chunks[t].size;
+            }
+            else
+            {
+                loader_discard(chunks[t].entries, chunks[t].size);
+            }
+            chunks[t].size = 0;
+        }
+
+        //keep the partial line after the block for the next one
+        memmove(buffer, buffer + length, held - length);
+        held -= length;
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        free(chunks[t].entries);
+    }
+    free(chunks);
+    free(buffer);
+
+    if (status == LOADER_NO_MEMORY)
+    {
+        loader_result_destroy(result);
+    }
+
+    return status;
+}
+
+void loader_result_destroy(loader_result *result)
+{
+    loader_discard(result->entries, result->size);
+    free(result->entries);
+    result->entries = NULL;
+    result->size = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "entry.h"
+
+//outcomes of reading a field of distributions
+typedef enum loader_status {LOADER_OK, LOADER_INVALID, LOADER_NO_MEMORY} loader_status;
+
+/**
+ * The entries of a field, in the order they were read
+ *
+ * @param entries the entries, each with its own id and distribution
+ * @param size the number of entries
+ * @param bytes the number of bytes read from the input
+ */
+typedef struct _loader_result
+{
+    entry *entries;
+    size_t size;
+    size_t bytes;
+} loader_result;
+
+/**
+ * Reads entries from the given stream up to the first blank line or the
+ * end of the stream.  The input is read in blocks that are split into
+ * line-aligned chunks, and the chunks are parsed by the given number of
+ * threads.  The entries are the same as if the lines had been read one by
+ * one with entry_read, stopping at the first invalid line.  The entries
+ * before an invalid line are kept so that the caller can check them
+ * first, as it would have when reading them one by one.  Ids are not
+ * checked for duplicates.
+ *
+ * @param in a stream, non-NULL
+ * @param max_id a positive integer
+ * @param battlefields a positive integer
+ * @param threads the number of threads to use, positive
+ * @param result a pointer to the result to fill in, non-NULL
+ * @return LOADER_OK if the input ended with a blank line or end-of-file,
+ * LOADER_INVALID if it ended with an invalid line, or LOADER_NO_MEMORY if
+ * there was an allocation or thread creation error, in which case the
+ * result holds no entries
+ */
+loader_status loader_read(FILE *in, int max_id, int battlefields, int threads, loader_result *result);
+
+/**
+ * Frees the entries in the given result.
+ *
+ * @param result a pointer to a result filled in by loader_read, non-NULL
+ */
+void loader_result_destroy(loader_result *result);
+
+#endif
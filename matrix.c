@@ -0,0 +1,332 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "matrix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//identifies a matrix file and the version of its layout
+#define MATRIX_MAGIC "BLOTTOM1"
+
+//written as a number so a matrix read on a machine of the other byte order can be told apart
+#define MATRIX_BYTE_ORDER 0x01020304u
+
+//bytes of the header, before the weights
+#define MATRIX_HEADER 64
+
+//the matrices start on page boundaries so each can be mapped on its own
+#define MATRIX_ALIGN 4096
+
+//columns of a tile, a multiple of 4 so that a byte of outcomes is only written by one thread
+#define MATRIX_TILE 512
+
+//most bytes of a band of rows; two bands are held at a time
+#define MATRIX_BAND_BYTES (32 << 20)
+
+/**
+ * The columns of a band of rows worked out by one thread
+ *
+ * @param classes the players' distributions
+ * @param weights the weight of each battlefield
+ * @param total the sum of the weights, which the scores are shares of
+ * @param player_classes the class of each player
+ * @param n the number of players
+ * @param score_bits the width of the scores, 0 for none
+ * @param first_row the index of the first row of the band
+ * @param rows the number of rows in the band
+ * @param first_col the index of the first column of this thread, a multiple of 4
+ * @param last_col one past the index of the last column of this thread
+ * @param outcomes the outcome rows of the band
+ * @param scores the score rows of the band
+ */
+typedef struct _matrix_task
+{
+    const dist_table *classes;
+    const double *weights;
+    double total;
+    const size_t *player_classes;
+    size_t n;
+    int score_bits;
+    size_t first_row;
+    size_t rows;
+    size_t first_col;
+    size_t last_col;
+    unsigned char *outcomes;
+    unsigned char *scores;
+} matrix_task;
+
+void *matrix_run_task(void *arg);
+int matrix_start(matrix_task *tasks, pthread_t *ids, int threads);
+bool matrix_finish(pthread_t *ids, int started, int threads);
+bool matrix_write_at(int fd, const void *data, size_t len, uint64_t at);
+uint64_t matrix_align(uint64_t at);
+
+void *matrix_run_task(void *arg)
+{
+    matrix_task *task = arg;
+    size_t row_bytes = (task->n + 3) / 4;
+    size_t score_bytes = task->score_bits / 8;
+    double scale = (task->score_bits == 16 ? UINT16_MAX : UINT8_MAX);
+
+    int battlefields = dist_table_battlefields(task->classes);
+    pair_outcome *outcomes = malloc(sizeof(pair_outcome) * MATRIX_TILE);
+    double *shares = malloc(sizeof(double) * 3 * battlefields);
+    if (outcomes == NULL || shares == NULL)
+    {
+        free(outcomes);
+        free(shares);
+        return task;
+    }
+    score_shares(task->weights, battlefields, shares);
+
+    //each tile of columns is paired with every row of the band while its distributions are in cache
+    for (size_t first = task->first_col; first < task->last_col; first += MATRIX_TILE)
+    {
+        size_t last = (task->last_col - first > MATRIX_TILE ? first + MATRIX_TILE : task->last_col);
+        for (size_t r = 0; r < task->rows; r++)
+        {
+            unsigned char *outcome_row = task->outcomes + r * row_bytes;
+            unsigned char *score_row = task->scores + r * task->n * score_bytes;
+            memset(outcome_row + first / 4, 0, (last - first + 3) / 4);
+            dist_table_score_row(task->classes, task->player_classes[task->first_row + r], task->player_classes + first, last - first, shares, outcomes);
+
+            for (size_t j = first; j < last; j++)
+            {
+                const pair_outcome *outcome = &outcomes[j - first];
+                unsigned int code = (outcome->wins1 == 1 ? MATRIX_WIN : (outcome->wins1 == 0 ? MATRIX_LOSS : MATRIX_TIE));
+                outcome_row[j / 4] |= code << (2 * (j % 4));
+
+                if (score_bytes == 1)
+                {
+                    score_row[j] = (uint8_t) (outcome->score1 / task->total * scale + 0.5);
+                }
+
+                else if (score_bytes == 2)
+                {
+                    uint16_t score = (uint16_t) (outcome->score1 / task->total * scale + 0.5);
+                    memcpy(score_row + 2 * j, &score, sizeof(score));
+                }
+            }
+        }
+    }
+
+    free(outcomes);
+    free(shares);
+    return NULL;
+}
+
+matrix_status matrix_export(const char *path, const dist_table *classes, const double *weights, const char **ids,
+                            const size_t *player_classes, size_t n, int score_bits, int threads)
+{
+    int battlefields = dist_table_battlefields(classes);
+    size_t row_bytes = (n + 3) / 4;
+    size_t score_bytes = score_bits / 8;
+
+    //where each part of the file goes
+    uint64_t outcomes_at = matrix_align(MATRIX_HEADER + sizeof(double) * battlefields);
+    uint64_t scores_at = (score_bits > 0 ? matrix_align(outcomes_at + (uint64_t) n * row_bytes) : 0);
+    uint64_t ids_at = (score_bits > 0 ? scores_at + (uint64_t) n * n * score_bytes : outcomes_at + (uint64_t) n * row_bytes);
+    size_t ids_len = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        ids_len += 1 + strlen(ids[i]);
+    }
+
+    //as many rows to a band as fit, and no more threads than groups of 4 columns
+    size_t band_row = row_bytes + n * score_bytes;
+    size_t band_rows = MATRIX_BAND_BYTES / (band_row > 0 ? band_row : 1);
+    band_rows = (band_rows < 1 ? 1 : (band_rows > n ? n : band_rows));
+    if ((size_t) threads > row_bytes)
+    {
+        threads = (row_bytes > 0 ? row_bytes : 1);
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        total += weights[i];
+    }
+
+    unsigned char *bands[2];
+    bands[0] = malloc(band_rows * band_row + 1);
+    bands[1] = malloc(band_rows * band_row + 1);
+    matrix_task *tasks = malloc(sizeof(matrix_task) * threads);
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    unsigned char *header = calloc(1, outcomes_at);
+    char *id_bytes = malloc(ids_len + 1);
+    if (bands[0] == NULL || bands[1] == NULL || tasks == NULL || tids == NULL || header == NULL || id_bytes == NULL)
+    {
+        free(bands[0]);
+        free(bands[1]);
+        free(tasks);
+        free(tids);
+        free(header);
+        free(id_bytes);
+        return MATRIX_NO_MEMORY;
+    }
+
+    //the header, laid out as documented
+    uint32_t order = MATRIX_BYTE_ORDER;
+    uint32_t count = battlefields;
+    uint64_t players = n;
+    uint32_t width = score_bits;
+    uint64_t size = ids_at + ids_len;
+    memcpy(header, MATRIX_MAGIC, strlen(MATRIX_MAGIC));
+    memcpy(header + 8, &order, sizeof(order));
+    memcpy(header + 12, &count, sizeof(count));
+    memcpy(header + 16, &players, sizeof(players));
+    memcpy(header + 24, &width, sizeof(width));
+    memcpy(header + 32, &outcomes_at, sizeof(outcomes_at));
+    memcpy(header + 40, &scores_at, sizeof(scores_at));
+    memcpy(header + 48, &ids_at, sizeof(ids_at));
+    memcpy(header + 56, &size, sizeof(size));
+    memcpy(header + MATRIX_HEADER, weights, sizeof(double) * battlefields);
+
+    size_t used = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t len = strlen(ids[i]);
+        id_bytes[used] = (char) len;
+        memcpy(id_bytes + used + 1, ids[i], len);
+        used += 1 + len;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    matrix_status result = (fd < 0 ? MATRIX_WRITE_ERROR : MATRIX_OK);
+    if (result == MATRIX_OK && !matrix_write_at(fd, header, outcomes_at, 0))
+    {
+        result = MATRIX_WRITE_ERROR;
+    }
+
+    //each band is worked out while the one before it is written
+    size_t written = 0;
+    for (size_t start = 0; result == MATRIX_OK && written < n; start += band_rows)
+    {
+        int started = 0;
+        size_t rows = (start < n ? (n - start < band_rows ? n - start : band_rows) : 0);
+        unsigned char *band = bands[(start / band_rows) % 2];
+        for (int t = 0; t < threads && rows > 0; t++)
+        {
+            tasks[t].classes = classes;
+            tasks[t].weights = weights;
+            tasks[t].total = total;
+            tasks[t].player_classes = player_classes;
+            tasks[t].n = n;
+            tasks[t].score_bits = score_bits;
+            tasks[t].first_row = start;
+            tasks[t].rows = rows;
+            tasks[t].first_col = (n * t / threads) & ~(size_t) 3;
+            tasks[t].last_col = (t == threads - 1 ? n : (n * (t + 1) / threads) & ~(size_t) 3);
+            tasks[t].outcomes = band;
+            tasks[t].scores = band + rows * row_bytes;
+        }
+        if (rows > 0)
+        {
+            started = matrix_start(tasks, tids, threads);
+        }
+
+        if (start > 0)
+        {
+            size_t end = (start < n ? start : n);
+            size_t prev_rows = end - written;
+            unsigned char *prev = bands[(start / band_rows + 1) % 2];
+            bool ok = matrix_write_at(fd, prev, prev_rows * row_bytes, outcomes_at + (uint64_t) written * row_bytes);
+            if (ok && score_bits > 0)
+            {
+                ok = matrix_write_at(fd, prev + prev_rows * row_bytes, prev_rows * n * score_bytes, scores_at + (uint64_t) written * n * score_bytes);
+            }
+            written = end;
+            result = (ok ? result : MATRIX_WRITE_ERROR);
+        }
+
+        if (rows > 0 && !matrix_finish(tids, started, threads))
+        {
+            result = MATRIX_NO_MEMORY;
+        }
+    }
+
+    if (result == MATRIX_OK && !matrix_write_at(fd, id_bytes, ids_len, ids_at))
+    {
+        result = MATRIX_WRITE_ERROR;
+    }
+
+    if (fd >= 0 && close(fd) != 0 && result == MATRIX_OK)
+    {
+        result = MATRIX_WRITE_ERROR;
+    }
+
+    //a matrix that is not whole is not left behind
+    if (fd >= 0 && result != MATRIX_OK)
+    {
+        remove(path);
+    }
+
+    free(bands[0]);
+    free(bands[1]);
+    free(tasks);
+    free(tids);
+    free(header);
+    free(id_bytes);
+
+    return result;
+}
+
+//starts a thread for each task, returning how many were started
+int matrix_start(matrix_task *tasks, pthread_t *ids, int threads)
+{
+    int started = 0;
+    while (started < threads && pthread_create(&ids[started], NULL, matrix_run_task, &tasks[started]) == 0)
+    {
+        started++;
+    }
+
+    return started;
+}
+
+//waits for the started threads, returning false if any failed or not all were started
+bool matrix_finish(pthread_t *ids, int started, int threads)
+{
+    //a thread returns non-NULL if it could not allocate its buffer
+    bool ok = (started == threads);
+    for (int t = 0; t < started; t++)
+    {
+        void *status;
+        pthread_join(ids[t], &status);
+        if (status != NULL)
+        {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+bool matrix_write_at(int fd, const void *data, size_t len, uint64_t at)
+{
+    //pwrite can write less than asked, so it is called until everything is written
+    const char *bytes = data;
+    while (len > 0)
+    {
+        ssize_t done = pwrite(fd, bytes, len, (off_t) at);
+        if (done <= 0)
+        {
+            return false;
+        }
+        bytes += done;
+        len -= done;
+        at += done;
+    }
+
+    return true;
+}
+
+uint64_t matrix_align(uint64_t at)
+{
+    return (at + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+}
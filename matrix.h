@@ -0,0 +1,61 @@
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+
+#include <stdlib.h>
+
+#include "distribution.h"
+
+//outcomes of writing a matrix
+typedef enum matrix_status {MATRIX_OK, MATRIX_NO_MEMORY, MATRIX_WRITE_ERROR} matrix_status;
+
+/**
+ * The outcome of a pairing as stored in a matrix, from the point of view
+ * of the player of the row
+ */
+#define MATRIX_LOSS 0
+#define MATRIX_TIE 1
+#define MATRIX_WIN 2
+
+/**
+ * Writes the outcome of every pairing of the given players to a file that
+ * can be mapped into memory and read in place.  All numbers are in the
+ * byte order of the machine that wrote the file, which the header records.
+ *
+ * The file starts with a 64-byte header: the magic "BLOTTOM1", a 32-bit
+ * byte-order mark 0x01020304, the 32-bit number of battlefields, the
+ * 64-bit number of players n, the 32-bit score width in bits (0, 8 or 16),
+ * 32 bits of zero, then the 64-bit offsets of the outcome matrix, the
+ * score matrix (0 if there is none) and the ids, and the 64-bit size of
+ * the file.  The weights follow as doubles.
+ *
+ * The outcome matrix has a row of (n + 3) / 4 bytes for each player,
+ * holding 2 bits for each opponent: the outcome for player i against
+ * player j is bits 2 * (j % 4) and up of byte i * ((n + 3) / 4) + j / 4,
+ * one of MATRIX_LOSS, MATRIX_TIE and MATRIX_WIN.  The score matrix has a
+ * row of n scores for each player, the share of the total weight player i
+ * scores against player j scaled to the largest number the width holds
+ * and rounded.  Both matrices start on a 4096-byte boundary.  The ids
+ * come last, each a byte holding its length followed by its characters.
+ *
+ * The matrix is worked out a band of rows at a time, so that only a few
+ * bands are ever held in memory however large the matrix is.  Each band is
+ * split among the given number of threads by columns and worked out in
+ * tiles, so that the distributions of a tile's columns stay in cache
+ * while its rows are paired with them, and is written while the next one
+ * is worked out.
+ *
+ * @param path the name of the file, non-NULL
+ * @param classes a pointer to the table of the players' distributions, non-NULL
+ * @param weights the weight of each battlefield, all positive, non-NULL
+ * @param ids the id of each player, each fewer than 256 characters, non-NULL
+ * @param player_classes the index of the class of each player, non-NULL
+ * @param n the number of players
+ * @param score_bits 0 for no score matrix, or 8 or 16
+ * @param threads the number of threads to use, positive
+ * @return MATRIX_OK, MATRIX_NO_MEMORY for an allocation or thread creation
+ * error, or MATRIX_WRITE_ERROR if the file could not be written
+ */
+matrix_status matrix_export(const char *path, const dist_table *classes, const double *weights, const char **ids,
+                            const size_t *player_classes, size_t n, int score_bits, int threads);
+
+#endif
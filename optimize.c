@@ -0,0 +1,509 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "optimize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "reorder.h"
+
+//random moves of units made to the best distribution found to start a climb from it
+#define OPTIMIZE_KICKS 3
+
+/**
+ * How a distribution fares against the field
+ *
+ * @param wins the wins against the field, ties count as half a win
+ * @param margin the total over the field of the weight the distribution
+ * wins less the weight its opponent wins, which orders distributions as
+ * their overall score does
+ */
+typedef struct _optimize_value
+{
+    double wins;
+    double margin;
+} optimize_value;
+
+/**
+ * The field as every thread searches it
+ *
+ * @param battlefields the number of battlefields
+ * @param weights the weight of each battlefield
+ * @param values the distributions of the classes with members, battlefield
+ * by battlefield, so the value of class c on battlefield i is at i * count + c
+ * @param members the number of members of each class with members
+ * @param count the number of classes with members
+ * @param exact true if the weight won less the weight lost is held exactly,
+ * so its sign always agrees with score_matchup on who wins
+ * @param tie how close to zero the weight won less the weight lost can be
+ * when it is not exact and still have its sign differ from score_matchup's
+ * @param plan how to search
+ * @param deadline when to stop searching
+ */
+typedef struct _optimize_shared
+{
+    int battlefields;
+    const double *weights;
+    int *values;
+    double *members;
+    size_t count;
+    bool exact;
+    double tie;
+    const optimize_plan *plan;
+    struct timespec deadline;
+} optimize_shared;
+
+/**
+ * The search run by one thread
+ *
+ * @param shared the field and the plan
+ * @param state the state of the thread's xorshift64* generator
+ * @param current the distribution being climbed from
+ * @param signs battlefield by battlefield, as values is laid out, 1 where
+ * current has more units than a class, 0 where the same and -1 where fewer
+ * @param diffs the weight current wins less the weight each class wins
+ * @param value the value of current
+ * @param best the best distributions the thread has found, best first
+ * @param best_values the value of each of best
+ * @param found the number of distributions in best
+ * @param cuts room for the cut points of a random distribution
+ */
+typedef struct _optimize_task
+{
+    const optimize_shared *shared;
+    uint64_t state;
+    int *current;
+    signed char *signs;
+    double *diffs;
+    optimize_value value;
+    int *best;
+    optimize_value *best_values;
+    size_t found;
+    int *cuts;
+} optimize_task;
+
+void *optimize_run_task(void *arg);
+bool optimize_climb(optimize_task *task);
+void optimize_start(optimize_task *task, bool from_best);
+void optimize_evaluate(optimize_task *task);
+optimize_value optimize_try(const optimize_task *task, int from, int to, int step);
+double optimize_win(const optimize_task *task, size_t c, double diff, int from, int to, int step);
+void optimize_insert(int *list, optimize_value *values, size_t *size, size_t keep, int battlefields, bool by_score,
+                     const int *distribution, const optimize_value *value);
+int optimize_compare(const optimize_value *v1, const optimize_value *v2, bool by_score);
+bool optimize_time_left(const struct timespec *deadline);
+uint64_t optimize_random(uint64_t *state);
+
+bool optimize_field(const dist_table *classes, const double *weights, const optimize_plan *plan, int threads, int *best, size_t *found)
+{
+    int battlefields = dist_table_battlefields(classes);
+    size_t num_classes = dist_table_size(classes);
+    optimize_shared shared;
+    shared.battlefields = battlefields;
+    shared.weights = weights;
+    shared.plan = plan;
+    shared.count = 0;
+
+    //sums of weights that are not multiples of a half are rounded, differently from how score_matchup rounds its two scores,
+    //so a near tie is settled the way score_matchup settles it
+    double half;
+    double total = 0.0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        total += fabs(weights[i]);
+    }
+    shared.exact = uniform_weights(weights, battlefields, &half) || reorder_is_exact(weights, battlefields, 1);
+    shared.tie = 4 * (battlefields + 2) * DBL_EPSILON * total;
+    shared.values = malloc(sizeof(int) * battlefields * (num_classes > 0 ? num_classes : 1));
+    shared.members = malloc(sizeof(double) * (num_classes > 0 ? num_classes : 1));
+    int *distribution = malloc(sizeof(int) * battlefields);
+    optimize_value *best_values = malloc(sizeof(optimize_value) * plan->keep);
+    optimize_task *tasks = calloc(threads, sizeof(optimize_task));
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    bool ok = (shared.values != NULL && shared.members != NULL && distribution != NULL && best_values != NULL && tasks != NULL && ids != NULL);
+
+    //classes that have lost all their members are not part of the field
+    for (size_t cls = 0; ok && cls < num_classes; cls++)
+    {
+        if (dist_table_count(classes, cls) > 0)
+        {
+            shared.members[shared.count] = dist_table_count(classes, cls);
+            dist_table_get(classes, cls, distribution);
+            for (int i = 0; i < battlefields; i++)
+            {
+                shared.values[i * num_classes + shared.count] = distribution[i];
+            }
+            shared.count++;
+        }
+    }
+
+    //the values were laid out for every class, so they are packed down to those with members
+    for (int i = 1; ok && i < battlefields; i++)
+    {
+        memmove(shared.values + i * shared.count, shared.values + i * num_classes, sizeof(int) * shared.count);
+    }
+
+    for (int t = 0; ok && t < threads; t++)
+    {
+        optimize_task *task = &tasks[t];
+        task->shared = &shared;
+        task->state = (plan->seed * 0x9E3779B97F4A7C15ULL + 1) ^ ((t + 1) * 0xBF58476D1CE4E5B9ULL);
+        task->state = (task->state != 0 ? task->state : 1);
+        task->current = malloc(sizeof(int) * battlefields);
+        task->signs = malloc(battlefields * (shared.count > 0 ? shared.count : 1));
+        task->diffs = malloc(sizeof(double) * (shared.count > 0 ? shared.count : 1));
+        task->best = malloc(sizeof(int) * battlefields * plan->keep);
+        task->best_values = malloc(sizeof(optimize_value) * plan->keep);
+        task->cuts = malloc(sizeof(int) * (battlefields + 1));
+        ok = (task->current != NULL && task->signs != NULL && task->diffs != NULL && task->best != NULL && task->best_values != NULL && task->cuts != NULL);
+    }
+
+    //every thread stops at the same time, however far its climb has got
+    int started = 0;
+    if (ok)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &shared.deadline);
+        time_t whole = (time_t) plan->seconds;
+        shared.deadline.tv_sec += whole;
+        shared.deadline.tv_nsec += (long) ((plan->seconds - whole) * 1e9);
+        if (shared.deadline.tv_nsec >= 1000000000L)
+        {
+            shared.deadline.tv_sec++;
+            shared.deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    for (int t = 0; ok && t < threads; t++)
+    {
+        if (pthread_create(&ids[t], NULL, optimize_run_task, &tasks[t]) != 0)
+        {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(ids[t], NULL);
+    }
+
+    //the threads' finds are merged in thread order, so equal ones are kept once
+    *found = 0;
+    for (int t = 0; ok && t < threads; t++)
+    {
+        for (size_t i = 0; i < tasks[t].found; i++)
+        {
+            optimize_insert(best, best_values, found, plan->keep, battlefields, plan->by_score,
+                            tasks[t].best + i * battlefields, &tasks[t].best_values[i]);
+        }
+    }
+
+    for (int t = 0; tasks != NULL && t < threads; t++)
+    {
+        free(tasks[t].current);
+        free(tasks[t].signs);
+        free(tasks[t].diffs);
+        free(tasks[t].best);
+        free(tasks[t].best_values);
+        free(tasks[t].cuts);
+    }
+    free(shared.values);
+    free(shared.members);
+    free(distribution);
+    free(best_values);
+    free(tasks);
+    free(ids);
+
+    return ok;
+}
+
+void *optimize_run_task(void *arg)
+{
+    optimize_task *task = arg;
+    int battlefields = task->shared->battlefields;
+
+    //climbs start from a random distribution and from the best one found in turn
+    bool from_best = false;
+    bool more = true;
+    while (more)
+    {
+        optimize_start(task, from_best);
+        more = optimize_climb(task);
+        optimize_insert(task->best, task->best_values, &task->found, task->shared->plan->keep, battlefields,
+                        task->shared->plan->by_score, task->current, &task->value);
+        from_best = !from_best;
+
+        //with one battlefield there is only one distribution
+        more = more && battlefields > 1;
+    }
+
+    return NULL;
+}
+
+//climbs from the current distribution, returning false if the time ran out first
+bool optimize_climb(optimize_task *task)
+{
+    const optimize_shared *s = task->shared;
+    int battlefields = s->battlefields;
+    int step = (s->plan->units / battlefields > 1 ? s->plan->units / battlefields : 1);
+
+    while (step > 0)
+    {
+        if (!optimize_time_left(&s->deadline))
+        {
+            return false;
+        }
+
+        //the move of step units that helps most, if any does
+        int best_from = -1;
+        int best_to = -1;
+        optimize_value best_value = task->value;
+        for (int from = 0; from < battlefields; from++)
+        {
+            for (int to = 0; to < battlefields && task->current[from] >= step; to++)
+            {
+                if (to != from)
+                {
+                    optimize_value value = optimize_try(task, from, to, step);
+                    if (optimize_compare(&value, &best_value, s->plan->by_score) > 0)
+                    {
+                        best_from = from;
+                        best_to = to;
+                        best_value = value;
+                    }
+                }
+            }
+        }
+
+        //every distribution climbed through is a candidate, not just where the climb ends
+        if (best_from >= 0)
+        {
+            task->current[best_from] -= step;
+            task->current[best_to] += step;
+            optimize_evaluate(task);
+            optimize_insert(task->best, task->best_values, &task->found, s->plan->keep, battlefields,
+                            s->plan->by_score, task->current, &task->value);
+        }
+
+        else
+        {
+            step /= 2;
+        }
+    }
+
+    return true;
+}
+
+void optimize_start(optimize_task *task, bool from_best)
+{
+    const optimize_shared *s = task->shared;
+    int battlefields = s->battlefields;
+    int units = s->plan->units;
+
+    //a few random moves of units away from the best distribution so far
+    if (from_best && task->found > 0)
+    {
+        memcpy(task->current, task->best, sizeof(int) * battlefields);
+        for (int k = 0; k < OPTIMIZE_KICKS; k++)
+        {
+            int from = optimize_random(&task->state) % battlefields;
+            int to = optimize_random(&task->state) % battlefields;
+            int most = (task->current[from] < 1 + units / battlefields ? task->current[from] : 1 + units / battlefields);
+            int moved = (most > 0 ? 1 + optimize_random(&task->state) % most : 0);
+            task->current[from] -= moved;
+            task->current[to] += moved;
+        }
+    }
+
+    //otherwise the units between cut points drawn at random, one battlefield to each gap
+    else
+    {
+        int *cuts = task->cuts;
+        cuts[0] = 0;
+        cuts[battlefields] = units;
+        for (int i = 1; i < battlefields; i++)
+        {
+            int cut = optimize_random(&task->state) % ((uint64_t) units + 1);
+            int j = i;
+            for (; j > 1 && cuts[j - 1] > cut; j--)
+            {
+                cuts[j] = cuts[j - 1];
+            }
+            cuts[j] = cut;
+        }
+        for (int i = 0; i < battlefields; i++)
+        {
+            task->current[i] = cuts[i + 1] - cuts[i];
+        }
+    }
+
+    optimize_evaluate(task);
+}
+
+//function for scoring the current distribution against every class from scratch
+void optimize_evaluate(optimize_task *task)
+{
+    const optimize_shared *s = task->shared;
+    size_t count = s->count;
+
+    //the outcomes are worked out again after each move, rather than moved along, so errors in the weights' sums do not build up
+    for (size_t c = 0; c < count; c++)
+    {
+        task->diffs[c] = 0.0;
+    }
+    for (int i = 0; i < s->battlefields; i++)
+    {
+        const int *values = s->values + i * count;
+        signed char *signs = task->signs + i * count;
+        int units = task->current[i];
+        for (size_t c = 0; c < count; c++)
+        {
+            signs[c] = (units > values[c]) - (units < values[c]);
+            task->diffs[c] += s->weights[i] * signs[c];
+        }
+    }
+
+    task->value.wins = 0.0;
+    task->value.margin = 0.0;
+    for (size_t c = 0; c < count; c++)
+    {
+        task->value.wins += s->members[c] * optimize_win(task, c, task->diffs[c], 0, 0, 0);
+        task->value.margin += s->members[c] * task->diffs[c];
+    }
+}
+
+//function for the value of the current distribution with step units moved, from the outcome against each class so far
+optimize_value optimize_try(const optimize_task *task, int from, int to, int step)
+{
+    const optimize_shared *s = task->shared;
+    size_t count = s->count;
+    const int *from_values = s->values + from * count;
+    const int *to_values = s->values + to * count;
+    const signed char *from_signs = task->signs + from * count;
+    const signed char *to_signs = task->signs + to * count;
+    double from_weight = s->weights[from];
+    double to_weight = s->weights[to];
+    int from_units = task->current[from] - step;
+    int to_units = task->current[to] + step;
+
+    //only the two battlefields the units move between can change their outcome
+    optimize_value value = {0.0, 0.0};
+    for (size_t c = 0; c < count; c++)
+    {
+        int from_sign = (from_units > from_values[c]) - (from_units < from_values[c]);
+        int to_sign = (to_units > to_values[c]) - (to_units < to_values[c]);
+        double diff = task->diffs[c] + from_weight * (from_sign - from_signs[c]) + to_weight * (to_sign - to_signs[c]);
+        value.wins += s->members[c] * optimize_win(task, c, diff, from, to, step);
+        value.margin += s->members[c] * diff;
+    }
+
+    return value;
+}
+
+//function for the win against a class of the current distribution with step units moved, given the weight it wins less the weight the class wins
+double optimize_win(const optimize_task *task, size_t c, double diff, int from, int to, int step)
+{
+    const optimize_shared *s = task->shared;
+    if (s->exact || fabs(diff) > s->tie)
+    {
+        return 0.5 * ((diff >= 0) + (diff > 0));
+    }
+
+    //the two scores added up battlefield by battlefield, as score_matchup adds them
+    double score1 = 0.0;
+    double score2 = 0.0;
+    for (int i = 0; i < s->battlefields; i++)
+    {
+        int units = task->current[i] - (i == from ? step : 0) + (i == to ? step : 0);
+        int value = s->values[i * s->count + c];
+        if (units > value)
+        {
+            score1 += s->weights[i];
+        }
+
+        else if (units == value)
+        {
+            score1 += (s->weights[i]/2);
+            score2 += (s->weights[i]/2);
+        }
+
+        else
+        {
+            score2 += s->weights[i];
+        }
+    }
+
+    return (score1 > score2 ? 1.0 : (score1 == score2 ? 0.5 : 0.0));
+}
+
+//function for adding a distribution to a list kept best first, unless it is already there or is not among the best
+void optimize_insert(int *list, optimize_value *values, size_t *size, size_t keep, int battlefields, bool by_score,
+                     const int *distribution, const optimize_value *value)
+{
+    for (size_t i = 0; i < *size; i++)
+    {
+        if (memcmp(list + i * battlefields, distribution, sizeof(int) * battlefields) == 0)
+        {
+            return;
+        }
+    }
+
+    //a distribution goes after those as good as it, so the first found of equal ones comes first
+    size_t at = *size;
+    while (at > 0 && optimize_compare(value, &values[at - 1], by_score) > 0)
+    {
+        at--;
+    }
+    if (at == keep)
+    {
+        return;
+    }
+
+    size_t moved = (*size < keep ? *size : keep - 1) - at;
+    memmove(list + (at + 1) * battlefields, list + at * battlefields, sizeof(int) * battlefields * moved);
+    memmove(values + at + 1, values + at, sizeof(optimize_value) * moved);
+    memcpy(list + at * battlefields, distribution, sizeof(int) * battlefields);
+    values[at] = *value;
+    if (*size < keep)
+    {
+        (*size)++;
+    }
+}
+
+int optimize_compare(const optimize_value *v1, const optimize_value *v2, bool by_score)
+{
+    //the value searched for first, then the other
+    double first1 = (by_score ? v1->margin : v1->wins);
+    double first2 = (by_score ? v2->margin : v2->wins);
+    double second1 = (by_score ? v1->wins : v1->margin);
+    double second2 = (by_score ? v2->wins : v2->margin);
+
+    if (first1 != first2)
+    {
+        return (first1 > first2 ? 1 : -1);
+    }
+
+    return (second1 > second2) - (second1 < second2);
+}
+
+bool optimize_time_left(const struct timespec *deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec < deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec < deadline->tv_nsec);
+}
+
+//function for the next number of the xorshift64* generator, as gen_tournament uses
+uint64_t optimize_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
@@ -0,0 +1,61 @@
+#ifndef __OPTIMIZE_H__
+#define __OPTIMIZE_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "distribution.h"
+
+/**
+ * How to search for the best responses to a field
+ *
+ * @param units the number of units every distribution places, positive
+ * @param seconds how long to search for, positive
+ * @param keep the number of distributions to find, positive
+ * @param by_score true to search for the highest average score, false for
+ * the highest win rate
+ * @param seed the seed for where each search starts
+ */
+typedef struct _optimize_plan
+{
+    int units;
+    double seconds;
+    size_t keep;
+    bool by_score;
+    uint64_t seed;
+} optimize_plan;
+
+/**
+ * Searches for the distributions of the plan's units that do best against
+ * every member of the field whose distributions are held in the given
+ * table, as query_field would score them.  Each thread climbs from a
+ * starting distribution by moving units from one battlefield to another,
+ * taking the move that helps most and halving the number of units moved
+ * when no move helps, until not even moving one unit helps.  Ties on the
+ * value searched for are broken by the other value.  A move only changes
+ * two battlefields, so it is scored against each class from the class's
+ * outcome so far and those two battlefields alone.  Each climb starts
+ * either from a random distribution or from a random change to the best
+ * one found so far, and climbs are started until the time is up.
+ *
+ * The starting points are drawn from generators seeded from the plan's
+ * seed, but how many climbs finish depends on the time and the threads,
+ * so the distributions found may differ from run to run.
+ *
+ * @param classes a pointer to the table of the field's distributions, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param plan a pointer to how to search, non-NULL
+ * @param threads the number of threads to use, positive
+ * @param best an array with room for plan->keep distributions of the
+ * table's battlefield count, one after the other, set to those found,
+ * best first, non-NULL
+ * @param found a pointer to a size_t set to the number of distributions
+ * found, which is fewer than plan->keep if there are not that many
+ * distributions of the units, non-NULL
+ * @return true if the search ran, false if there was an allocation or
+ * thread creation error
+ */
+bool optimize_field(const dist_table *classes, const double *weights, const optimize_plan *plan, int threads, int *best, size_t *found);
+
+#endif
@@ -0,0 +1,119 @@
+#include "query.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+ * The share of the candidates scored by one thread
+ *
+ * @param classes the field's distributions
+ * @param weights the weight of each battlefield
+ * @param candidates all of the candidates
+ * @param results the results of all the candidates
+ * @param first the index of the first candidate of this thread
+ * @param last one past the index of the last candidate of this thread
+ */
+typedef struct _query_task
+{
+    const dist_table *classes;
+    const double *weights;
+    int **candidates;
+    query_result *results;
+    size_t first;
+    size_t last;
+} query_task;
+
+void *query_run_task(void *arg);
+
+void *query_run_task(void *arg)
+{
+    query_task *task = arg;
+    int battlefields = dist_table_battlefields(task->classes);
+    size_t num_classes = dist_table_size(task->classes);
+
+    signed char *outcomes = malloc(battlefields);
+    if (outcomes == NULL)
+    {
+        return task;
+    }
+
+    for (size_t i = task->first; i < task->last; i++)
+    {
+        query_result *r = &task->results[i];
+        r->wins = 0.0;
+        r->overall_score = 0.0;
+        r->games = 0.0;
+
+        for (size_t cls = 0; cls < num_classes; cls++)
+        {
+            //the class is compared as the first distribution, so its score is score1
+            pair_outcome outcome;
+            dist_table_compare_to(task->classes, cls, task->candidates[i], outcomes);
+            score_matchup(outcomes, battlefields, task->weights, &outcome);
+
+            //every member of the class gets the same outcome
+            double members = dist_table_count(task->classes, cls);
+            r->wins += members * (1 - outcome.wins1);
+            r->overall_score += members * outcome.score2;
+            r->games += members;
+        }
+    }
+
+    free(outcomes);
+    return NULL;
+}
+
+bool query_field(const dist_table *classes, const double *weights, int **candidates, size_t n, int threads, query_result *results)
+{
+    if ((size_t) threads > n)
+    {
+        threads = (n > 0 ? n : 1);
+    }
+
+    query_task *tasks = malloc(sizeof(query_task) * threads);
+    pthread_t *ids = malloc(sizeof(pthread_t) * threads);
+    if (tasks == NULL || ids == NULL)
+    {
+        free(tasks);
+        free(ids);
+        return false;
+    }
+
+    //give each thread a contiguous block of candidates
+    int started = 0;
+    bool ok = true;
+    for (int t = 0; t < threads; t++)
+    {
+        tasks[t].classes = classes;
+        tasks[t].weights = weights;
+        tasks[t].candidates = candidates;
+        tasks[t].results = results;
+        tasks[t].first = n * t / threads;
+        tasks[t].last = n * (t + 1) / threads;
+
+        if (pthread_create(&ids[t], NULL, query_run_task, &tasks[t]) != 0)
+        {
+            ok = false;
+            break;
+        }
+        started++;
+    }
+
+    //a thread returns non-NULL if it could not allocate its buffer
+    for (int t = 0; t < started; t++)
+    {
+        void *status;
+        pthread_join(ids[t], &status);
+        if (status != NULL)
+        {
+            ok = false;
+        }
+    }
+
+    free(tasks);
+    free(ids);
+
+    return ok;
+}
@@ -0,0 +1,41 @@
+#ifndef __QUERY_H__
+#define __QUERY_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "distribution.h"
+
+/**
+ * How a candidate distribution fares against every member of a field
+ *
+ * @param wins the wins against the field, ties count as half a win
+ * @param overall_score the total score earned against the field
+ * @param games the number of field members played
+ */
+typedef struct _query_result
+{
+    double wins;
+    double overall_score;
+    double games;
+} query_result;
+
+/**
+ * Scores each candidate distribution against every member of the field
+ * whose distributions are held in the given table.  Each class of the
+ * table is compared to a candidate once and the outcome is counted once
+ * per member of the class.  Candidates are split among the given number
+ * of threads.
+ *
+ * @param classes a pointer to the table of the field's distributions, non-NULL
+ * @param weights the weight of each battlefield, non-NULL
+ * @param candidates an array of n distributions of the table's battlefield count, non-NULL
+ * @param n the number of candidates
+ * @param threads the number of threads to use, positive
+ * @param results an array with room for n results, non-NULL
+ * @return true if the candidates were scored, false if there was an allocation
+ * or thread creation error
+ */
+bool query_field(const dist_table *classes, const double *weights, int **candidates, size_t n, int threads, query_result *results);
+
+#endif
@@ -0,0 +1,83 @@
+#include "reorder.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+//the players in a tile, whose data is read together, as a power of two
+#define REORDER_TILE_BITS 12
+
+//most buckets sorted into, for which tiles are made larger in huge fields
+#define REORDER_MAX_BUCKETS (1 << 20)
+
+//largest integer up to which every integer is held exactly by a double
+#define REORDER_EXACT_LIMIT 9007199254740992.0
+
+bool reorder_matchups(matchup_pair *pairs, size_t n, size_t players)
+{
+    //a field that fits in one tile is already read from cache
+    int shift = REORDER_TILE_BITS;
+    size_t tiles = (players >> shift) + 1;
+    if (tiles == 1)
+    {
+        return true;
+    }
+    while (tiles * tiles > REORDER_MAX_BUCKETS)
+    {
+        shift++;
+        tiles = (players >> shift) + 1;
+    }
+
+    size_t buckets = tiles * tiles;
+    size_t *starts = calloc(buckets, sizeof(size_t));
+    matchup_pair *sorted = malloc(sizeof(matchup_pair) * (n > 0 ? n : 1));
+    if (starts == NULL || sorted == NULL)
+    {
+        free(starts);
+        free(sorted);
+        return false;
+    }
+
+    //one counting sort on the pair of tiles, which keeps the order within each
+    for (size_t i = 0; i < n; i++)
+    {
+        starts[(pairs[i].first >> shift) * tiles + (pairs[i].second >> shift)]++;
+    }
+
+    size_t start = 0;
+    for (size_t b = 0; b < buckets; b++)
+    {
+        size_t count = starts[b];
+        starts[b] = start;
+        start += count;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sorted[starts[(pairs[i].first >> shift) * tiles + (pairs[i].second >> shift)]++] = pairs[i];
+    }
+
+    memcpy(pairs, sorted, sizeof(matchup_pair) * n);
+    free(starts);
+    free(sorted);
+    return true;
+}
+
+bool reorder_is_exact(const double *weights, int battlefields, size_t matchups)
+{
+    //scores are then multiples of a quarter, and so are all their sums
+    double total = 0.0;
+    for (int i = 0; i < battlefields; i++)
+    {
+        if (!isfinite(weights[i]) || weights[i] * 2 != floor(weights[i] * 2))
+        {
+            return false;
+        }
+        total += weights[i];
+    }
+
+    //a player facing itself gets the whole total from both sides
+    return (double) matchups * total * 2 * 4 < REORDER_EXACT_LIMIT;
+}
@@ -0,0 +1,51 @@
+#ifndef __REORDER_H__
+#define __REORDER_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A matchup between two players, each given by its index in the field.
+ * The indices are held in 32 bits, so only fields of at most UINT32_MAX
+ * players can have their matchups held this way.
+ *
+ * @param first the index of the first player
+ * @param second the index of the second player
+ */
+typedef struct _matchup_pair
+{
+    uint32_t first;
+    uint32_t second;
+} matchup_pair;
+
+/**
+ * Sorts the given matchups by the tiles of the square of players they fall
+ * in, each tile covering a few thousand players on each side, so that
+ * matchups next to each other in the array involve players whose data is
+ * still in cache.  Matchups in the same tile keep their order.
+ *
+ * @param pairs an array of n matchups, non-NULL
+ * @param n the number of matchups
+ * @param players the number of players, greater than every index in pairs
+ * @return true if the matchups were sorted, false if there was an
+ * allocation error, in which case they are left as they were
+ */
+bool reorder_matchups(matchup_pair *pairs, size_t n, size_t players);
+
+
+/**
+ * Determines whether every total that playing the given number of
+ * matchups under the given weights can add up is held exactly by a
+ * double, in which case the totals do not depend on the order the
+ * matchups are played in.  This holds when each weight is a multiple of
+ * one half and the largest possible total is small enough.
+ *
+ * @param weights the weight of each battlefield, non-NULL
+ * @param battlefields the number of battlefields
+ * @param matchups the number of matchups
+ * @return true if the totals are exact in any order
+ */
+bool reorder_is_exact(const double *weights, int battlefields, size_t matchups);
+
+#endif
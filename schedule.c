@@ -0,0 +1,398 @@
+#include "schedule.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * A player's place in the ranking a Swiss round is paired from
+ *
+ * @param wins the player's wins so far
+ * @param score the player's total score so far
+ * @param tiebreak a number drawn for the player, which orders players that are level
+ * @param index the index of the player
+ */
+typedef struct _ranked
+{
+    double wins;
+    double score;
+    uint64_t tiebreak;
+    size_t index;
+} ranked;
+
+/**
+ * @param kind the kind of schedule
+ * @param players the number of players
+ * @param size the number of rounds, opponents or players in a group
+ * @param state the state of the xorshift64* generator
+ * @param order the players in a random order (round robin), or the pool
+ * opponents are drawn from (random)
+ * @param player the next player to draw opponents for (random)
+ * @param picks the opponents drawn for the current player (random)
+ * @param pick_next the next of the picks to make a matchup of (random)
+ * @param pick_count the number of picks (random)
+ * @param current the player the picks are for (random)
+ * @param group the position in order of the first player of the current group (round robin)
+ * @param a the position in order of the first player of the next matchup (round robin)
+ * @param b the position in order of the second player of the next matchup (round robin)
+ * @param round the number of rounds paired (Swiss)
+ * @param round_pairs the matchups of the current round (Swiss)
+ * @param round_size the number of matchups in the current round (Swiss)
+ * @param round_next the next matchup of the current round to make (Swiss)
+ * @param opponents the opponents each player has met, size to a player (Swiss)
+ * @param met the number of opponents each player has met (Swiss)
+ * @param tiebreaks the number drawn for each player to order level players (Swiss)
+ * @param ranking room for the ranking of the players (Swiss)
+ * @param paired whether each player has been paired in the current round (Swiss)
+ */
+struct _schedule
+{
+    schedule_kind kind;
+    size_t players;
+    size_t size;
+    uint64_t state;
+    size_t *order;
+    size_t player;
+    size_t *picks;
+    size_t pick_next;
+    size_t pick_count;
+    size_t current;
+    size_t group;
+    size_t a;
+    size_t b;
+    size_t round;
+    matchup_pair *round_pairs;
+    size_t round_size;
+    size_t round_next;
+    size_t *opponents;
+    size_t *met;
+    uint64_t *tiebreaks;
+    ranked *ranking;
+    bool *paired;
+};
+
+uint64_t schedule_random(schedule *s);
+size_t schedule_below(schedule *s, size_t n);
+size_t schedule_next_random(schedule *s, matchup_pair *pairs, size_t n);
+size_t schedule_next_round_robin(schedule *s, matchup_pair *pairs, size_t n);
+size_t schedule_next_swiss(schedule *s, matchup_pair *pairs, size_t n, const double *wins, const double *scores);
+void schedule_pair_round(schedule *s, const double *wins, const double *scores);
+bool schedule_have_met(const schedule *s, size_t p1, size_t p2);
+int schedule_compare_ranked(const void *key1, const void *key2);
+
+bool schedule_fits(schedule_kind kind, size_t players, size_t size)
+{
+    //the pairs a schedule makes hold player indices in 32 bits
+    return size > 0 && players <= UINT32_MAX && (kind != SCHEDULE_RANDOM || size < players) && (kind != SCHEDULE_ROUND_ROBIN || size >= 2);
+}
+
+schedule *schedule_create(schedule_kind kind, size_t players, size_t size, uint64_t seed)
+{
+    if (!schedule_fits(kind, players, size))
+    {
+        return NULL;
+    }
+
+    schedule *s = calloc(1, sizeof(schedule));
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    s->kind = kind;
+    s->players = players;
+    s->size = size;
+    s->state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    s->order = malloc(sizeof(size_t) * (players > 0 ? players : 1));
+    bool ok = (s->order != NULL);
+    for (size_t i = 0; ok && i < players; i++)
+    {
+        s->order[i] = i;
+    }
+
+    if (ok && kind == SCHEDULE_RANDOM)
+    {
+        //one more is drawn than needed, so that the player itself can be dropped
+        s->picks = malloc(sizeof(size_t) * (size + 1));
+        ok = (s->picks != NULL);
+    }
+
+    else if (ok && kind == SCHEDULE_ROUND_ROBIN)
+    {
+        //groups are consecutive runs of a shuffle of the players
+        for (size_t i = players; i > 1; i--)
+        {
+            size_t j = schedule_below(s, i);
+            size_t t = s->order[i - 1];
+            s->order[i - 1] = s->order[j];
+            s->order[j] = t;
+        }
+        s->b = 1;
+    }
+
+    else if (ok)
+    {
+        s->round_pairs = malloc(sizeof(matchup_pair) * (players / 2 + 1));
+        s->opponents = malloc(sizeof(size_t) * (players > 0 ? players : 1) * size);
+        s->met = calloc((players > 0 ? players : 1), sizeof(size_t));
+        s->tiebreaks = malloc(sizeof(uint64_t) * (players > 0 ? players : 1));
+        s->ranking = malloc(sizeof(ranked) * (players > 0 ? players : 1));
+        s->paired = malloc(sizeof(bool) * (players > 0 ? players : 1));
+        ok = (s->round_pairs != NULL && s->opponents != NULL && s->met != NULL && s->tiebreaks != NULL && s->ranking != NULL && s->paired != NULL);
+        for (size_t i = 0; ok && i < players; i++)
+        {
+            s->tiebreaks[i] = schedule_random(s);
+        }
+    }
+
+    if (!ok)
+    {
+        schedule_destroy(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+size_t schedule_next(schedule *s, matchup_pair *pairs, size_t n, const double *wins, const double *scores)
+{
+    if (s->kind == SCHEDULE_RANDOM)
+    {
+        return schedule_next_random(s, pairs, n);
+    }
+
+    else if (s->kind == SCHEDULE_ROUND_ROBIN)
+    {
+        return schedule_next_round_robin(s, pairs, n);
+    }
+
+    else
+    {
+        return schedule_next_swiss(s, pairs, n, wins, scores);
+    }
+}
+
+void schedule_destroy(schedule *s)
+{
+    free(s->order);
+    free(s->picks);
+    free(s->round_pairs);
+    free(s->opponents);
+    free(s->met);
+    free(s->tiebreaks);
+    free(s->ranking);
+    free(s->paired);
+    free(s);
+}
+
+//function for the next number of the xorshift64* generator, as gen_tournament uses
+uint64_t schedule_random(schedule *s)
+{
+    s->state ^= s->state >> 12;
+    s->state ^= s->state << 25;
+    s->state ^= s->state >> 27;
+    return s->state * 0x2545F4914F6CDD1DULL;
+}
+
+size_t schedule_below(schedule *s, size_t n)
+{
+    return schedule_random(s) % n;
+}
+
+size_t schedule_next_random(schedule *s, matchup_pair *pairs, size_t n)
+{
+    size_t made = 0;
+    while (made < n)
+    {
+        if (s->pick_next == s->pick_count)
+        {
+            if (s->player == s->players)
+            {
+                break;
+            }
+
+            //a partial shuffle of the pool draws size + 1 different players
+            size_t want = s->size + 1;
+            for (size_t t = 0; t < want; t++)
+            {
+                size_t r = t + schedule_below(s, s->players - t);
+                size_t swap = s->order[t];
+                s->order[t] = s->order[r];
+                s->order[r] = swap;
+            }
+
+            //the player itself is dropped if it was drawn, otherwise the last one drawn is
+            s->pick_count = 0;
+            for (size_t t = 0; t < want && s->pick_count < s->size; t++)
+            {
+                if (s->order[t] != s->player)
+                {
+                    s->picks[s->pick_count++] = s->order[t];
+                }
+            }
+            s->pick_next = 0;
+            s->current = s->player;
+            s->player++;
+        }
+
+        pairs[made].first = s->current;
+        pairs[made].second = s->picks[s->pick_next++];
+        made++;
+    }
+
+    return made;
+}
+
+size_t schedule_next_round_robin(schedule *s, matchup_pair *pairs, size_t n)
+{
+    size_t made = 0;
+    while (made < n && s->group < s->players)
+    {
+        size_t end = (s->players - s->group > s->size ? s->group + s->size : s->players);
+        if (s->b >= end)
+        {
+            s->a++;
+            s->b = s->a + 1;
+        }
+
+        //every pair in the group has been made, so move to the next group
+        if (s->a + 1 >= end)
+        {
+            s->group = end;
+            s->a = end;
+            s->b = end + 1;
+            continue;
+        }
+
+        pairs[made].first = s->order[s->a];
+        pairs[made].second = s->order[s->b];
+        made++;
+        s->b++;
+    }
+
+    return made;
+}
+
+size_t schedule_next_swiss(schedule *s, matchup_pair *pairs, size_t n, const double *wins, const double *scores)
+{
+    //a round is only paired once the one before it has been played
+    if (s->round_next == s->round_size)
+    {
+        if (s->round == s->size)
+        {
+            return 0;
+        }
+        schedule_pair_round(s, wins, scores);
+        s->round++;
+    }
+
+    size_t made = s->round_size - s->round_next;
+    if (made > n)
+    {
+        made = n;
+    }
+    memcpy(pairs, s->round_pairs + s->round_next, sizeof(matchup_pair) * made);
+    s->round_next += made;
+
+    return made;
+}
+
+void schedule_pair_round(schedule *s, const double *wins, const double *scores)
+{
+    for (size_t i = 0; i < s->players; i++)
+    {
+        s->ranking[i].wins = wins[i];
+        s->ranking[i].score = scores[i];
+        s->ranking[i].tiebreak = s->tiebreaks[i];
+        s->ranking[i].index = i;
+        s->paired[i] = false;
+    }
+    qsort(s->ranking, s->players, sizeof(ranked), schedule_compare_ranked);
+
+    s->round_size = 0;
+    s->round_next = 0;
+    for (size_t a = 0; a < s->players; a++)
+    {
+        size_t p1 = s->ranking[a].index;
+        if (s->paired[p1])
+        {
+            continue;
+        }
+
+        //the highest ranked player left not met yet, or the highest ranked left if all have been met
+        size_t choice = s->players;
+        for (size_t b = a + 1; b < s->players; b++)
+        {
+            size_t p2 = s->ranking[b].index;
+            if (s->paired[p2])
+            {
+                continue;
+            }
+            if (choice == s->players)
+            {
+                choice = b;
+            }
+            if (!schedule_have_met(s, p1, p2))
+            {
+                choice = b;
+                break;
+            }
+        }
+
+        //no one is left, so the player sits the round out
+        if (choice == s->players)
+        {
+            continue;
+        }
+
+        size_t p2 = s->ranking[choice].index;
+        s->paired[p1] = true;
+        s->paired[p2] = true;
+        s->opponents[p1 * s->size + s->met[p1]++] = p2;
+        s->opponents[p2 * s->size + s->met[p2]++] = p1;
+        s->round_pairs[s->round_size].first = p1;
+        s->round_pairs[s->round_size].second = p2;
+        s->round_size++;
+    }
+}
+
+bool schedule_have_met(const schedule *s, size_t p1, size_t p2)
+{
+    const size_t *met = s->opponents + p1 * s->size;
+    for (size_t i = 0; i < s->met[p1]; i++)
+    {
+        if (met[i] == p2)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int schedule_compare_ranked(const void *key1, const void *key2)
+{
+    //most wins first, then highest score, then the numbers drawn
+    const ranked *r1 = key1;
+    const ranked *r2 = key2;
+
+    if (r1->wins != r2->wins)
+    {
+        return (r1->wins > r2->wins ? -1 : 1);
+    }
+
+    else if (r1->score != r2->score)
+    {
+        return (r1->score > r2->score ? -1 : 1);
+    }
+
+    else if (r1->tiebreak != r2->tiebreak)
+    {
+        return (r1->tiebreak < r2->tiebreak ? -1 : 1);
+    }
+
+    else
+    {
+        return (r1->index < r2->index ? -1 : (r1->index > r2->index));
+    }
+}
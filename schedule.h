@@ -0,0 +1,87 @@
+#ifndef __SCHEDULE_H__
+#define __SCHEDULE_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "reorder.h"
+
+struct _schedule;
+typedef struct _schedule schedule;
+
+/**
+ * The ways a schedule can pair up players
+ *
+ * SCHEDULE_SWISS: rounds in which players with similar standings meet, avoiding rematches
+ * SCHEDULE_RANDOM: each player meets a number of different opponents drawn at random
+ * SCHEDULE_ROUND_ROBIN: players are split into groups at random and meet everyone in their group
+ */
+typedef enum schedule_kind {SCHEDULE_SWISS, SCHEDULE_RANDOM, SCHEDULE_ROUND_ROBIN} schedule_kind;
+
+/**
+ * Determines whether a schedule of the given kind and size can be made
+ * between the given number of players.
+ *
+ * @param kind the kind of schedule
+ * @param players the number of players
+ * @param size the number of rounds, opponents or players in a group
+ * @return true if the size suits the kind of schedule and number of
+ * players, and there are at most UINT32_MAX players
+ */
+bool schedule_fits(schedule_kind kind, size_t players, size_t size);
+
+
+/**
+ * Creates a schedule of matchups between the given number of players,
+ * which are made up as they are asked for rather than stored.  The same
+ * seed gives the same schedule.
+ *
+ * For a Swiss schedule, size is the number of rounds.  The first round is
+ * drawn at random; each later round ranks the players by wins, then by
+ * score, and pairs each player with the highest ranked player left that it
+ * has not met yet, or has met if there is no other.  When the number of
+ * players is odd the lowest ranked player left over sits the round out.
+ *
+ * For a random schedule, size is the number of opponents each player is
+ * given, all different and none of them the player itself, so it must be
+ * less than the number of players.
+ *
+ * For a round-robin schedule, size is the number of players in each group,
+ * at least 2; the last group has whoever is left over.
+ *
+ * @param kind the kind of schedule
+ * @param players the number of players, indexed from 0
+ * @param size the number of rounds, opponents or players in a group, positive
+ * @param seed the seed for the random choices
+ * @return a pointer to the new schedule, or NULL if the schedule does not
+ * fit, as schedule_fits decides, or there was an allocation error; it is
+ * the caller's responsibility to destroy the schedule
+ */
+schedule *schedule_create(schedule_kind kind, size_t players, size_t size, uint64_t seed);
+
+
+/**
+ * Makes the next matchups of the given schedule.  The matchups made by one
+ * call must be played before the next call, as a Swiss schedule pairs each
+ * round from the standings passed in when the round starts; a call never
+ * makes matchups of two rounds.
+ *
+ * @param s a pointer to a schedule, non-NULL
+ * @param pairs an array with room for n matchups, non-NULL
+ * @param n the most matchups to make, positive
+ * @param wins the wins of each player so far, non-NULL
+ * @param scores the total score of each player so far, non-NULL
+ * @return the number of matchups made, or 0 if the schedule is over
+ */
+size_t schedule_next(schedule *s, matchup_pair *pairs, size_t n, const double *wins, const double *scores);
+
+
+/**
+ * Destroys the given schedule.
+ *
+ * @param s a pointer to a schedule, non-NULL
+ */
+void schedule_destroy(schedule *s);
+
+#endif
@@ -0,0 +1,606 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "entry.h"
+
+//most connections served at once
+#define SERVER_MAX_CONNECTIONS 256
+
+//most bytes in the body of a request, and how much more of a body is made room for at a time
+#define SERVER_MAX_BODY (64 << 20)
+#define SERVER_BODY_CHUNK (64 << 10)
+
+/**
+ * A version of the field, shared by the requests that started while it
+ * was current
+ *
+ * @param field the field, not changed while it is shared
+ * @param refs the number of requests using this snapshot, guarded by the
+ * server's lock
+ * @param ranking_lock guards the ranking
+ * @param ranking the results of the standing matchups on this field, made
+ * by the first RANKING request, or NULL
+ * @param ranking_error why the ranking could not be made, if it could not
+ */
+typedef struct _snapshot
+{
+    blotto_field *field;
+    size_t refs;
+    pthread_mutex_t ranking_lock;
+    blotto_results *ranking;
+    blotto_error ranking_error;
+} snapshot;
+
+/**
+ * @param lock guards current, the snapshots' reference counts, connections and stopping
+ * @param current the snapshot new requests use
+ * @param update_lock taken by updates so that each one starts from the last
+ * @param done signalled when a connection closes
+ * @param connections the sockets of the open connections
+ * @param num_connections the number of open connections
+ * @param stopping true once a SHUTDOWN request has been received
+ * @param listener the listening socket
+ * @param weights the weight of each battlefield
+ * @param matchups the standing matchups
+ * @param len the number of bytes in matchups
+ * @param threads the number of threads a QUERY may use
+ */
+typedef struct _server
+{
+    pthread_mutex_t lock;
+    snapshot *current;
+    pthread_mutex_t update_lock;
+    pthread_cond_t done;
+    int connections[SERVER_MAX_CONNECTIONS];
+    int num_connections;
+    bool stopping;
+    int listener;
+    const double *weights;
+    const char *matchups;
+    size_t len;
+    int threads;
+} server;
+
+/**
+ * @param s the server
+ * @param fd the socket of the connection
+ */
+typedef struct _connection
+{
+    server *s;
+    int fd;
+} connection;
+
+snapshot *snapshot_create(blotto_field *field);
+snapshot *snapshot_acquire(server *s);
+void snapshot_release(server *s, snapshot *snap);
+void snapshot_destroy(snapshot *snap);
+void *serve_connection(void *arg);
+bool serve_request(server *s, char *line, FILE *in, FILE *response);
+char *read_body(FILE *in, size_t len, blotto_error *error);
+void write_results(FILE *response, blotto_results *results, blotto_order order, bool query);
+blotto_error apply_updates(blotto_field *field, const char *body, size_t len);
+bool parse_order(const char *word, blotto_order *order);
+bool clear_socket_path(const struct sockaddr_un *address);
+
+snapshot *snapshot_create(blotto_field *field)
+{
+    snapshot *snap = malloc(sizeof(snapshot));
+    if (snap == NULL)
+    {
+        return NULL;
+    }
+
+    snap->field = field;
+    snap->refs = 0;
+    snap->ranking = NULL;
+    snap->ranking_error = BLOTTO_OK;
+    pthread_mutex_init(&snap->ranking_lock, NULL);
+    return snap;
+}
+
+//takes a reference to the current snapshot so it outlives any swap
+snapshot *snapshot_acquire(server *s)
+{
+    pthread_mutex_lock(&s->lock);
+    snapshot *snap = s->current;
+    snap->refs++;
+    pthread_mutex_unlock(&s->lock);
+    return snap;
+}
+
+//the last request to use a snapshot that is no longer current frees it
+void snapshot_release(server *s, snapshot *snap)
+{
+    pthread_mutex_lock(&s->lock);
+    snap->refs--;
+    bool unused = (snap->refs == 0 && snap != s->current);
+    pthread_mutex_unlock(&s->lock);
+
+    if (unused)
+    {
+        snapshot_destroy(snap);
+    }
+}
+
+void snapshot_destroy(snapshot *snap)
+{
+    if (snap->ranking != NULL)
+    {
+        blotto_results_destroy(snap->ranking);
+    }
+    pthread_mutex_destroy(&snap->ranking_lock);
+    blotto_field_destroy(snap->field);
+    free(snap);
+}
+
+bool serve(const char *path, blotto_field *field, const double *weights, const char *matchups, size_t len, int threads)
+{
+    server s;
+    s.current = snapshot_create(field);
+    s.num_connections = 0;
+    s.stopping = false;
+    s.weights = weights;
+    s.matchups = matchups;
+    s.len = len;
+    s.threads = threads;
+    if (s.current == NULL)
+    {
+        blotto_field_destroy(field);
+        return false;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        snapshot_destroy(s.current);
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    //a socket left behind by an earlier server is replaced, but nothing else is
+    s.listener = -1;
+    if (!clear_socket_path(&address)
+        || (s.listener = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+        || bind(s.listener, (struct sockaddr*) &address, sizeof(address)) != 0
+        || listen(s.listener, SOMAXCONN) != 0)
+    {
+        if (s.listener != -1)
+        {
+            close(s.listener);
+        }
+        snapshot_destroy(s.current);
+        return false;
+    }
+
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_mutex_init(&s.update_lock, NULL);
+    pthread_cond_init(&s.done, NULL);
+
+    while (true)
+    {
+        int fd = accept(s.listener, NULL, NULL);
+        pthread_mutex_lock(&s.lock);
+        bool stopping = s.stopping;
+        pthread_mutex_unlock(&s.lock);
+        if (fd == -1 && stopping)
+        {
+            break;
+        }
+        else if (fd == -1)
+        {
+            continue;
+        }
+
+        //connections beyond the limit are turned away
+        pthread_mutex_lock(&s.lock);
+        bool room = (s.num_connections < SERVER_MAX_CONNECTIONS && !s.stopping);
+        if (room)
+        {
+            s.connections[s.num_connections++] = fd;
+        }
+        pthread_mutex_unlock(&s.lock);
+
+        connection *c = malloc(sizeof(connection));
+        pthread_t id;
+        if (!room || c == NULL)
+        {
+            free(c);
+            close(fd);
+        }
+        else
+        {
+            c->s = &s;
+            c->fd = fd;
+            if (pthread_create(&id, NULL, serve_connection, c) == 0)
+            {
+                pthread_detach(id);
+            }
+            else
+            {
+                //take the connection back off the list
+                pthread_mutex_lock(&s.lock);
+                for (int i = 0; i < s.num_connections; i++)
+                {
+                    if (s.connections[i] == fd)
+                    {
+                        s.connections[i] = s.connections[--s.num_connections];
+                        break;
+                    }
+                }
+                pthread_mutex_unlock(&s.lock);
+                free(c);
+                close(fd);
+            }
+        }
+    }
+
+    //wake the connections still waiting for requests and wait for them to close
+    pthread_mutex_lock(&s.lock);
+    for (int i = 0; i < s.num_connections; i++)
+    {
+        shutdown(s.connections[i], SHUT_RD);
+    }
+    while (s.num_connections > 0)
+    {
+        pthread_cond_wait(&s.done, &s.lock);
+    }
+    pthread_mutex_unlock(&s.lock);
+
+    close(s.listener);
+    unlink(path);
+    snapshot_destroy(s.current);
+    pthread_mutex_destroy(&s.lock);
+    pthread_mutex_destroy(&s.update_lock);
+    pthread_cond_destroy(&s.done);
+
+    return true;
+}
+
+void *serve_connection(void *arg)
+{
+    connection *c = arg;
+    server *s = c->s;
+    int fd = c->fd;
+    free(c);
+
+    FILE *in = fdopen(fd, "r");
+    char *line = NULL;
+    size_t line_size = 0;
+    bool open = (in != NULL);
+    while (open && getline(&line, &line_size, in) != -1)
+    {
+        //the response is put together first so no lock is held while sending it
+        char *text = NULL;
+        size_t text_len = 0;
+        FILE *response = open_memstream(&text, &text_len);
+        if (response == NULL)
+        {
+            break;
+        }
+        open = serve_request(s, line, in, response);
+        fclose(response);
+
+        size_t sent = 0;
+        while (sent < text_len)
+        {
+            //a client that has gone away ends its own connection, not the server
+            ssize_t n = send(fd, text + sent, text_len - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                open = false;
+                break;
+            }
+            sent += n;
+        }
+        free(text);
+    }
+    free(line);
+
+    //the connection is taken off the list before its socket can be reused
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < s->num_connections; i++)
+    {
+        if (s->connections[i] == fd)
+        {
+            s->connections[i] = s->connections[--s->num_connections];
+            break;
+        }
+    }
+    if (in != NULL)
+    {
+        fclose(in);
+    }
+    else
+    {
+        close(fd);
+    }
+    pthread_cond_signal(&s->done);
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+//answers one request, returning false if the connection should be closed
+bool serve_request(server *s, char *line, FILE *in, FILE *response)
+{
+    char command[16] = "";
+    char word[16] = "";
+    size_t len = 0;
+    int fields = sscanf(line, "%15s %15s %zu", command, word, &len);
+    blotto_order order = BLOTTO_BY_WINS;
+
+    if (fields >= 1 && strcmp(command, "SHUTDOWN") == 0)
+    {
+        pthread_mutex_lock(&s->lock);
+        s->stopping = true;
+        pthread_mutex_unlock(&s->lock);
+
+        //wake the accept loop
+        shutdown(s->listener, SHUT_RDWR);
+        fprintf(response, "OK 0\n");
+        return false;
+    }
+
+    if (fields >= 2 && strcmp(command, "RANKING") == 0 && parse_order(word, &order))
+    {
+        snapshot *snap = snapshot_acquire(s);
+        pthread_mutex_lock(&snap->ranking_lock);
+        if (snap->ranking == NULL && snap->ranking_error == BLOTTO_OK)
+        {
+            snap->ranking = blotto_play_buffer(snap->field, s->weights, s->matchups, s->len, &snap->ranking_error);
+        }
+        if (snap->ranking != NULL)
+        {
+            write_results(response, snap->ranking, order, false);
+        }
+        else
+        {
+            fprintf(response, "ERR %s\n", blotto_strerror(snap->ranking_error));
+        }
+        pthread_mutex_unlock(&snap->ranking_lock);
+        snapshot_release(s, snap);
+        return true;
+    }
+
+    //the rest of the requests have a body
+    bool has_order = (strcmp(command, "PLAY") == 0 || strcmp(command, "QUERY") == 0);
+    if (fields >= 2 && strcmp(command, "UPDATE") == 0)
+    {
+        char *end;
+        len = strtoul(word, &end, 10);
+        fields = (end != word ? 3 : 2);
+    }
+    else if (!has_order || !parse_order(word, &order))
+    {
+        fprintf(response, "ERR bad request\n");
+        return true;
+    }
+    if (fields < 3)
+    {
+        fprintf(response, "ERR bad request\n");
+        return true;
+    }
+
+    //the body of a request that is too big is not read, so the connection cannot go on
+    if (len > SERVER_MAX_BODY)
+    {
+        fprintf(response, "ERR request too large\n");
+        return false;
+    }
+
+    blotto_error error = BLOTTO_OK;
+    char *body = read_body(in, len, &error);
+    if (body == NULL)
+    {
+        if (error != BLOTTO_OK)
+        {
+            fprintf(response, "ERR %s\n", blotto_strerror(error));
+        }
+        return false;
+    }
+
+    if (strcmp(command, "UPDATE") == 0)
+    {
+        //updates are made to a copy, which replaces the current snapshot only if all of them apply
+        pthread_mutex_lock(&s->update_lock);
+        snapshot *snap = snapshot_acquire(s);
+        blotto_field *copy = blotto_field_copy(snap->field, &error);
+        snapshot_release(s, snap);
+        if (copy != NULL)
+        {
+            error = apply_updates(copy, body, len);
+        }
+
+        snapshot *next = NULL;
+        if (copy != NULL && error == BLOTTO_OK && (next = snapshot_create(copy)) == NULL)
+        {
+            error = BLOTTO_NO_MEMORY;
+        }
+
+        if (next != NULL)
+        {
+            pthread_mutex_lock(&s->lock);
+            snapshot *old = s->current;
+            s->current = next;
+            bool unused = (old->refs == 0);
+            pthread_mutex_unlock(&s->lock);
+            if (unused)
+            {
+                snapshot_destroy(old);
+            }
+            fprintf(response, "OK 0\n");
+        }
+        else
+        {
+            if (copy != NULL)
+            {
+                blotto_field_destroy(copy);
+            }
+            fprintf(response, "ERR %s\n", blotto_strerror(error));
+        }
+        pthread_mutex_unlock(&s->update_lock);
+    }
+    else
+    {
+        bool query = (strcmp(command, "QUERY") == 0);
+        snapshot *snap = snapshot_acquire(s);
+        blotto_results *results = (query
+                                   ? blotto_query_buffer(snap->field, s->weights, body, len, s->threads, &error)
+                                   : blotto_play_buffer(snap->field, s->weights, body, len, &error));
+        snapshot_release(s, snap);
+
+        if (results != NULL)
+        {
+            write_results(response, results, order, query);
+            blotto_results_destroy(results);
+        }
+        else
+        {
+            fprintf(response, "ERR %s\n", blotto_strerror(error));
+        }
+    }
+
+    free(body);
+    return true;
+}
+
+//reads a body of len bytes, making room for it as it arrives so that a length the client
+//never sends is not allocated; NULL with error unset if the connection ends first
+char *read_body(FILE *in, size_t len, blotto_error *error)
+{
+    char *body = malloc(len < SERVER_BODY_CHUNK ? (len > 0 ? len : 1) : SERVER_BODY_CHUNK);
+    size_t room = (len < SERVER_BODY_CHUNK ? len : SERVER_BODY_CHUNK);
+    size_t got = 0;
+    while (body != NULL && got < len)
+    {
+        if (got == room)
+        {
+            room = (room * 2 < len ? room * 2 : len);
+            char *bigger = realloc(body, room);
+            if (bigger == NULL)
+            {
+                free(body);
+                body = NULL;
+                break;
+            }
+            body = bigger;
+        }
+
+        size_t n = fread(body + got, 1, room - got, in);
+        if (n == 0)
+        {
+            free(body);
+            return NULL;
+        }
+        got += n;
+    }
+
+    if (body == NULL)
+    {
+        *error = BLOTTO_NO_MEMORY;
+    }
+    return body;
+}
+
+void write_results(FILE *response, blotto_results *results, blotto_order order, bool query)
+{
+    blotto_results_sort(results, order);
+
+    size_t n = blotto_results_size(results);
+    fprintf(response, "OK %zu\n", n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const blotto_standing *st = blotto_results_get(results, i);
+        if (query)
+        {
+            fprintf(response, "%7.3f %7.3f %s\n", st->wins / st->games, st->overall_score / st->games, st->id);
+        }
+        else
+        {
+            fprintf(response, "%7.3f %s\n", (order == BLOTTO_BY_WINS ? st->wins : st->overall_score) / st->games, st->id);
+        }
+    }
+}
+
+//applies lines in the format of the field up to a blank line or the end
+blotto_error apply_updates(blotto_field *field, const char *body, size_t len)
+{
+    const char *pos = body;
+    const char *end = body + len;
+    blotto_error error = BLOTTO_OK;
+    while (error == BLOTTO_OK)
+    {
+        entry line = entry_parse(&pos, end, BLOTTO_MAX_ID, blotto_field_battlefields(field));
+        if (line.id == NULL)
+        {
+            return BLOTTO_INVALID_UPDATE;
+        }
+        else if (line.id[0] == '\0')
+        {
+            free(line.id);
+            break;
+        }
+
+        error = blotto_field_update(field, line.id, line.distribution);
+        entry_destroy(&line);
+    }
+
+    return error;
+}
+
+bool parse_order(const char *word, blotto_order *order)
+{
+    if (strcmp(word, "win") == 0)
+    {
+        *order = BLOTTO_BY_WINS;
+        return true;
+    }
+    else if (strcmp(word, "score") == 0)
+    {
+        *order = BLOTTO_BY_SCORE;
+        return true;
+    }
+
+    return false;
+}
+
+//function for removing a stale socket at the address, returning false if the path is not a socket or a server still answers on it
+bool clear_socket_path(const struct sockaddr_un *address)
+{
+    struct stat info;
+    if (lstat(address->sun_path, &info) != 0)
+    {
+        return errno == ENOENT;
+    }
+
+    if (!S_ISSOCK(info.st_mode))
+    {
+        return false;
+    }
+
+    //a socket that accepts a connection belongs to a running server
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe == -1)
+    {
+        return false;
+    }
+    bool live = (connect(probe, (const struct sockaddr*) address, sizeof(*address)) == 0);
+    close(probe);
+
+    return !live && unlink(address->sun_path) == 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "libblotto.h"
+
+/**
+ * Serves requests about the given field on a Unix domain socket at the
+ * given path until a SHUTDOWN request is received.  Each connection is
+ * handled by its own thread and can send any number of requests, each a
+ * line followed by a body of the given number of bytes where there is one:
+ *
+ *   PLAY win|score BYTES     plays the matchups in the body
+ *   QUERY win|score BYTES    scores the candidate distributions in the body
+ *   UPDATE BYTES             replaces the distributions of the players in
+ *                            the body, all or none of them
+ *   RANKING win|score        ranks the players by the standing matchups
+ *   SHUTDOWN                 stops the server
+ *
+ * Each request is answered by "OK N" followed by N lines formatted as the
+ * blotto program prints results, or by "ERR message".  A body of more than
+ * 64 MB is refused with an ERR and the connection is closed, since the
+ * body would otherwise be read as requests.  Requests work on a
+ * snapshot of the field, so reads run concurrently with each other and
+ * with updates, and an update is seen by requests that start after it.
+ *
+ * @param path the path of the socket, non-NULL
+ * @param field a pointer to a field, non-NULL, that the server takes over
+ * @param weights the weight of each battlefield, non-NULL
+ * @param matchups the standing matchups ranked by RANKING, non-NULL
+ * @param len the number of bytes in matchups
+ * @param threads the number of threads each QUERY may use, positive
+ * @return true if the server shut down when asked, false if the socket
+ * could not be set up, including when something other than a socket is at
+ * the path or another server is still answering on the socket there; a
+ * socket no server answers on is replaced
+ */
+bool serve(const char *path, blotto_field *field, const double *weights, const char *matchups, size_t len, int threads);
+
+#endif
@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+bool stats_enabled = false;
+
+size_t stats_counters[NUM_COUNTERS];
+
+//names of the phases and counters as they appear in the JSON output
+static const char *phase_names[] = {"parse_distributions", "parse_matchups", "lookups", "scoring", "sorting", "output"};
+static const char *counter_names[] = {"lookups", "rehashes", "allocations", "matchups", "bytes_read",
+                                      "pair_cache_hits", "pair_cache_misses"};
+
+//most maps that can be recorded with stats_add_map
+#define STATS_MAX_MAPS 8
+
+//one repetition in this many of a sampled stretch has its phases timed
+#define STATS_SAMPLE_EVERY 64
+
+//snapshots of maps and their names
+static const char *map_names[STATS_MAX_MAPS];
+static gmap_statistics maps[STATS_MAX_MAPS];
+static int num_maps = 0;
+
+//wall and CPU seconds charged to each phase
+static double phase_wall[PHASE_NONE];
+static double phase_cpu[PHASE_NONE];
+
+//the phase time is being charged to and when it started
+static stats_phase current = PHASE_NONE;
+static double start_wall;
+static double start_cpu;
+
+//a sampled stretch: when it started, the time its timed repetitions took
+//in each phase, whether this repetition is timed and how many until the next is
+static bool sampling = false;
+static double stretch_wall;
+static double stretch_cpu;
+static double sample_wall[PHASE_NONE];
+static double sample_cpu[PHASE_NONE];
+static bool timing = false;
+static int until_timed;
+
+double stats_seconds(clockid_t clock);
+void stats_charge(double *wall_by_phase, double *cpu_by_phase);
+void stats_dump_histogram(FILE *out, const size_t *counts);
+
+double stats_seconds(clockid_t clock)
+{
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+void stats_init(bool requested)
+{
+    stats_enabled = requested || getenv("BLOTTO_STATS") != NULL;
+}
+
+//function for charging the time since the current phase started to it, and starting it again
+void stats_charge(double *wall_by_phase, double *cpu_by_phase)
+{
+    double wall = stats_seconds(CLOCK_MONOTONIC);
+    double cpu = stats_seconds(CLOCK_PROCESS_CPUTIME_ID);
+
+    if (current != PHASE_NONE)
+    {
+        wall_by_phase[current] += wall - start_wall;
+        cpu_by_phase[current] += cpu - start_cpu;
+    }
+
+    start_wall = wall;
+    start_cpu = cpu;
+}
+
+void stats_switch(stats_phase phase)
+{
+    if (!stats_enabled || phase == current)
+    {
+        return;
+    }
+
+    //between timed repetitions of a sampled stretch only the phase is noted
+    if (!sampling)
+    {
+        stats_charge(phase_wall, phase_cpu);
+    }
+    else if (timing)
+    {
+        stats_charge(sample_wall, sample_cpu);
+    }
+
+    current = phase;
+}
+
+void stats_sample_begin(void)
+{
+    if (!stats_enabled || sampling)
+    {
+        return;
+    }
+
+    stats_charge(phase_wall, phase_cpu);
+    stretch_wall = start_wall;
+    stretch_cpu = start_cpu;
+    for (int p = 0; p < PHASE_NONE; p++)
+    {
+        sample_wall[p] = 0.0;
+        sample_cpu[p] = 0.0;
+    }
+
+    //the first repetition is timed, so even a short stretch has a sample
+    sampling = true;
+    timing = true;
+    until_timed = STATS_SAMPLE_EVERY;
+}
+
+void stats_sample_tick(void)
+{
+    if (!stats_enabled || !sampling)
+    {
+        return;
+    }
+
+    bool next = (--until_timed == 0);
+    if (timing)
+    {
+        stats_charge(sample_wall, sample_cpu);
+    }
+    else if (next)
+    {
+        start_wall = stats_seconds(CLOCK_MONOTONIC);
+        start_cpu = stats_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    if (next)
+    {
+        until_timed = STATS_SAMPLE_EVERY;
+    }
+    timing = next;
+}
+
+void stats_sample_end(void)
+{
+    if (!stats_enabled || !sampling)
+    {
+        return;
+    }
+
+    //the last timed repetition may have run up to here
+    if (timing)
+    {
+        stats_charge(sample_wall, sample_cpu);
+    }
+    else
+    {
+        start_wall = stats_seconds(CLOCK_MONOTONIC);
+        start_cpu = stats_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    }
+    sampling = false;
+    timing = false;
+
+    //the stretch's exact length is shared out as its timed repetitions were
+    double wall = start_wall - stretch_wall;
+    double cpu = start_cpu - stretch_cpu;
+    double sampled_wall = 0.0;
+    double sampled_cpu = 0.0;
+    for (int p = 0; p < PHASE_NONE; p++)
+    {
+        sampled_wall += sample_wall[p];
+        sampled_cpu += sample_cpu[p];
+    }
+    for (int p = 0; p < PHASE_NONE; p++)
+    {
+        phase_wall[p] += (sampled_wall > 0 ? wall * sample_wall[p] / sampled_wall : 0.0);
+        phase_cpu[p] += (sampled_cpu > 0 ? cpu * sample_cpu[p] / sampled_cpu : 0.0);
+    }
+    if (current != PHASE_NONE && sampled_wall == 0)
+    {
+        phase_wall[current] += wall;
+    }
+    if (current != PHASE_NONE && sampled_cpu == 0)
+    {
+        phase_cpu[current] += cpu;
+    }
+}
+
+void stats_add_map(const char *name, const gmap *m)
+{
+    if (!stats_enabled || num_maps == STATS_MAX_MAPS)
+    {
+        return;
+    }
+
+    map_names[num_maps] = name;
+    gmap_stats(m, &maps[num_maps]);
+    num_maps++;
+}
+
+//function for writing a histogram as a JSON array
+void stats_dump_histogram(FILE *out, const size_t *counts)
+{
+    fprintf(out, "[");
+    for (int i = 0; i < GMAP_HISTOGRAM_BUCKETS; i++)
+    {
+        fprintf(out, "%s%zu", (i > 0 ? ", " : ""), counts[i]);
+    }
+    fprintf(out, "]");
+}
+
+void stats_dump(FILE *out)
+{
+    if (!stats_enabled)
+    {
+        return;
+    }
+
+    //charge the time up to now before writing it out
+    stats_sample_end();
+    stats_phase phase = current;
+    stats_switch(PHASE_NONE);
+    stats_switch(phase);
+
+    fprintf(out, "{\"phases\": {");
+    for (int p = 0; p < PHASE_NONE; p++)
+    {
+        fprintf(out, "%s\"%s\": {\"wall_s\": %.6f, \"cpu_s\": %.6f}", (p > 0 ? ", " : ""),
+                phase_names[p], phase_wall[p], phase_cpu[p]);
+    }
+
+    fprintf(out, "}, \"counters\": {");
+    for (int c = 0; c < NUM_COUNTERS; c++)
+    {
+        fprintf(out, "%s\"%s\": %zu", (c > 0 ? ", " : ""), counter_names[c], stats_counters[c]);
+    }
+
+    size_t probes = stats_counters[COUNTER_CACHE_HITS] + stats_counters[COUNTER_CACHE_MISSES];
+    fprintf(out, "}, \"pair_cache_hit_rate\": %.4f, \"maps\": {",
+            (probes > 0 ? (double) stats_counters[COUNTER_CACHE_HITS] / probes : 0.0));
+
+    for (int i = 0; i < num_maps; i++)
+    {
+        const gmap_statistics *m = &maps[i];
+        fprintf(out, "%s\"%s\": {\"size\": %zu, \"capacity\": %zu, \"load_factor\": %.4f, \"chain_lengths\": ",
+                (i > 0 ? ", " : ""), map_names[i], m->size, m->capacity, m->load_factor);
+        stats_dump_histogram(out, m->chain_lengths);
+        fprintf(out, ", \"max_chain\": %zu, \"rehashes\": %zu, \"rehash_s\": %.6f, \"bytes\": %zu"
+                ", \"lookups\": %zu, \"probes\": %zu, \"max_probes\": %zu, \"probe_counts\": ",
+                m->max_chain, m->rehashes, m->rehash_seconds, m->bytes, m->lookups, m->probes, m->max_probes);
+        stats_dump_histogram(out, m->probe_counts);
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "}}\n");
+}
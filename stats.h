@@ -0,0 +1,126 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gmap.h"
+
+/**
+ * Phases of a run that time is charged to
+ */
+typedef enum stats_phase
+{
+    PHASE_PARSE_DISTRIBUTIONS,
+    PHASE_PARSE_MATCHUPS,
+    PHASE_LOOKUPS,
+    PHASE_SCORING,
+    PHASE_SORTING,
+    PHASE_OUTPUT,
+    PHASE_NONE
+} stats_phase;
+
+/**
+ * Events that are counted.  Lookups and allocations are counted where
+ * the players and standings are looked up and added: each search of one
+ * of those maps is a lookup, and each player, standing id and key added
+ * to one of those maps is an allocation, with the copy of a key and the
+ * entry holding it counted as two.  The table of distributions and the
+ * maps' own growth are not counted.
+ */
+typedef enum stats_counter
+{
+    COUNTER_LOOKUPS,
+    COUNTER_REHASHES,
+    COUNTER_ALLOCATIONS,
+    COUNTER_MATCHUPS,
+    COUNTER_BYTES_READ,
+    COUNTER_CACHE_HITS,
+    COUNTER_CACHE_MISSES,
+    NUM_COUNTERS
+} stats_counter;
+
+/**
+ * True when statistics are being recorded.  Everything else in this
+ * module only does work when it is set, so the cost of leaving the calls
+ * in place is one test of this flag.
+ */
+extern bool stats_enabled;
+
+/**
+ * The counts of each event so far; updated through STATS_ADD.
+ */
+extern size_t stats_counters[NUM_COUNTERS];
+
+/**
+ * Adds n to the given counter if statistics are being recorded.
+ */
+#define STATS_ADD(counter, n) do { if (stats_enabled) { stats_counters[counter] += (n); } } while (0)
+
+/**
+ * Starts recording statistics if requested, or if the environment
+ * variable BLOTTO_STATS is set.
+ *
+ * @param requested true if statistics were asked for on the command line
+ */
+void stats_init(bool requested);
+
+
+/**
+ * Stops charging time to the current phase and starts charging it to the
+ * given one.  Passing PHASE_NONE stops charging time to any phase.
+ *
+ * @param phase the phase that is starting
+ */
+void stats_switch(stats_phase phase);
+
+
+/**
+ * Starts a stretch of work, such as the matchups of a run, that switches
+ * phase too often for the clocks to be read at every switch.  Within the
+ * stretch stats_switch only notes the phase, except during the one
+ * repetition in every STATS_SAMPLE_EVERY that is timed in full.  The time
+ * from here to stats_sample_end is measured exactly and is split between
+ * the phases in the proportions the timed repetitions took.
+ */
+void stats_sample_begin(void);
+
+
+/**
+ * Marks the start of the next repetition of a stretch begun by
+ * stats_sample_begin.  There is no effect outside such a stretch.
+ */
+void stats_sample_tick(void);
+
+
+/**
+ * Ends a stretch begun by stats_sample_begin, charging its time to the
+ * phases.  Time is then charged as before, to the phase current when the
+ * stretch ended.  There is no effect outside such a stretch.
+ */
+void stats_sample_end(void);
+
+
+/**
+ * Records a snapshot of the given map's gmap_stats under the given name,
+ * to be written out by stats_dump.  There is no effect if statistics are
+ * not being recorded.
+ *
+ * @param name a name for the map that outlives the call to stats_dump, non-NULL
+ * @param m a pointer to a map, non-NULL
+ */
+void stats_add_map(const char *name, const gmap *m);
+
+
+/**
+ * Writes the time spent in each phase, the counters and the map
+ * snapshots as a JSON object
+ * followed by a newline.  There is no effect if statistics are not being
+ * recorded.
+ *
+ * @param out a file, non-NULL
+ */
+void stats_dump(FILE *out);
+
+#endif